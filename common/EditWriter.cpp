@@ -0,0 +1,187 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "common/EditWriter.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <utility>
+
+#include "clang/Tooling/Core/Replacement.h"
+#include "common/EmittedEditsIndex.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+const char kBeginEditsMarker[] = "==== BEGIN EDITS ====\n";
+const char kEndEditsMarker[] = "==== END EDITS ====\n";
+const char kBeginBinaryEditsMarker[] = "==== BEGIN BINARY EDITS ====\n";
+const char kEndBinaryEditsMarker[] = "==== END BINARY EDITS ====\n";
+
+const char kStringRecord = 's';
+const char kEditRecord = 'e';
+
+llvm::cl::opt<EditWriter::Format> edits_format_param(
+    "edits-format",
+    llvm::cl::desc("format of the emitted edits"),
+    llvm::cl::values(clEnumValN(EditWriter::Format::kText,
+                                "text",
+                                "one line per edit (default)"),
+                     clEnumValN(EditWriter::Format::kBinary,
+                                "binary",
+                                "compact binary records (decoded by "
+                                "extract_edits.py)")),
+    llvm::cl::init(EditWriter::Format::kText));
+
+llvm::cl::opt<std::string> emitted_edits_index_param(
+    "emitted-edits-index",
+    llvm::cl::value_desc("filepath"),
+    llvm::cl::desc("file shared by tool invocations to skip edits that were "
+                   "already emitted by another invocation (created if it "
+                   "doesn't exist)"));
+
+std::unique_ptr<EmittedEditsIndex> OpenEmittedEditsIndexFromCmdline() {
+  if (emitted_edits_index_param.empty())
+    return nullptr;
+
+  std::string error;
+  std::unique_ptr<EmittedEditsIndex> index =
+      EmittedEditsIndex::Open(emitted_edits_index_param, &error);
+  if (!index) {
+    llvm::errs() << "ERROR: Cannot open the file specified in --"
+                 << emitted_edits_index_param.ArgStr << " argument: "
+                 << emitted_edits_index_param << ": " << error << "\n";
+  }
+  return index;
+}
+
+}  // namespace
+
+EditWriter::EditWriter(llvm::raw_ostream* output)
+    : EditWriter(output,
+                 edits_format_param,
+                 OpenEmittedEditsIndexFromCmdline()) {}
+
+EditWriter::EditWriter(llvm::raw_ostream* output,
+                       Format format,
+                       std::unique_ptr<EmittedEditsIndex> emitted_edits_index)
+    : output_(output),
+      format_(format),
+      emitted_edits_index_(std::move(emitted_edits_index)) {}
+
+EditWriter::~EditWriter() = default;
+
+void EditWriter::BeginEdits() {
+  switch (format_) {
+    case Format::kText:
+      *output_ << kBeginEditsMarker;
+      break;
+    case Format::kBinary:
+      string_table_.clear();
+      *output_ << kBeginBinaryEditsMarker;
+      break;
+  }
+}
+
+void EditWriter::EndEdits() {
+  switch (format_) {
+    case Format::kText:
+      *output_ << kEndEditsMarker;
+      break;
+    case Format::kBinary:
+      *output_ << kEndBinaryEditsMarker;
+      break;
+  }
+}
+
+void EditWriter::WriteReplacement(
+    const clang::tooling::Replacement& replacement) {
+  WriteEdit("r", replacement.getFilePath(), replacement.getOffset(),
+            replacement.getLength(), replacement.getReplacementText());
+}
+
+void EditWriter::WriteIncludeUserHeader(llvm::StringRef file_path,
+                                        llvm::StringRef header) {
+  WriteEdit("include-user-header", file_path, -1, -1, header);
+}
+
+void EditWriter::WriteEdit(llvm::StringRef edit_type,
+                           llvm::StringRef file_path,
+                           int offset,
+                           int length,
+                           llvm::StringRef text) {
+  if (emitted_edits_index_ &&
+      !emitted_edits_index_->Insert(edit_type, file_path, offset, length,
+                                    text)) {
+    return;
+  }
+
+  if (format_ == Format::kText) {
+    *output_ << FormatEdit(edit_type, file_path, offset, length, text) << "\n";
+    return;
+  }
+
+  unsigned edit_type_index = InternString(edit_type);
+  unsigned file_path_index = InternString(file_path);
+  *output_ << kEditRecord;
+  llvm::encodeULEB128(edit_type_index, *output_);
+  llvm::encodeULEB128(file_path_index, *output_);
+  // -1 is used as the offset and length of edits like include-user-header.
+  assert(offset >= -1 && length >= -1);
+  llvm::encodeULEB128(offset + 1, *output_);
+  llvm::encodeULEB128(length + 1, *output_);
+  llvm::encodeULEB128(text.size(), *output_);
+  *output_ << text;
+}
+
+bool EditWriter::WriteFormattedEdit(llvm::StringRef line) {
+  if (format_ == Format::kText && !emitted_edits_index_) {
+    *output_ << line << "\n";
+    return true;
+  }
+
+  llvm::SmallVector<llvm::StringRef, 5> parts;
+  line.split(parts, ":::", 4);
+  int offset;
+  int length;
+  if (parts.size() != 5 || parts[2].getAsInteger(10, offset) ||
+      parts[3].getAsInteger(10, length)) {
+    return false;
+  }
+
+  std::string text = parts[4].str();
+  std::replace(text.begin(), text.end(), '\0', '\n');
+  WriteEdit(parts[0], parts[1], offset, length, text);
+  return true;
+}
+
+// static
+std::string EditWriter::FormatEdit(llvm::StringRef edit_type,
+                                   llvm::StringRef file_path,
+                                   int offset,
+                                   int length,
+                                   llvm::StringRef text) {
+  std::string result;
+  llvm::raw_string_ostream stream(result);
+  stream << edit_type << ":::" << file_path << ":::" << offset << ":::"
+         << length << ":::";
+  size_t text_start = stream.str().size();
+  stream << text;
+  stream.flush();
+  std::replace(result.begin() + text_start, result.end(), '\n', '\0');
+  return result;
+}
+
+unsigned EditWriter::InternString(llvm::StringRef str) {
+  auto result = string_table_.try_emplace(str, string_table_.size());
+  if (result.second) {
+    *output_ << kStringRecord;
+    llvm::encodeULEB128(str.size(), *output_);
+    *output_ << str;
+  }
+  return result.first->getValue();
+}
@@ -0,0 +1,108 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_COMMON_EDIT_WRITER_H_
+#define TOOLS_CLANG_COMMON_EDIT_WRITER_H_
+
+#include <memory>
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+namespace tooling {
+class Replacement;
+}  // namespace tooling
+}  // namespace clang
+
+namespace llvm {
+class raw_ostream;
+}  // namespace llvm
+
+class EmittedEditsIndex;
+
+// Writes edits in the format consumed by extract_edits.py and apply_edits.py
+// (see also tools/clang/scripts/run_tool.py):
+//     ==== BEGIN EDITS ====
+//     r:::<file path>:::<offset>:::<length>:::<replacement text>
+//     include-user-header:::<file path>:::-1:::-1:::<header>
+//     ==== END EDITS ====
+// Newlines in the replacement text are written as '\0'.
+//
+// When --edits-format=binary is passed to the tool, the edits are written in a
+// more compact format instead, which extract_edits.py converts back to the text
+// format above:
+//     ==== BEGIN BINARY EDITS ====
+//     <records>
+//     ==== END BINARY EDITS ====
+// Each record is either:
+//     's' <size> <bytes>
+// which appends a string (a file path or an edit type) to the string table, or:
+//     'e' <edit type> <file path> <offset + 1> <length + 1> <size> <bytes>
+// which is an edit whose type and file path are indices into the string table.
+// All the numbers are ULEB128-encoded.  Each BEGIN marker starts a new, empty
+// string table.
+//
+// When --emitted-edits-index=<path> is passed to the tool, edits that were
+// already written by another invocation of a tool using the same index (e.g.
+// edits of a header included by many translation units) are skipped.  The
+// index must not be reused across runs (run_tool.py --skip-duplicate-edits
+// creates a fresh one).  See EmittedEditsIndex for details.
+class EditWriter {
+ public:
+  enum class Format {
+    kText,
+    kBinary,
+  };
+
+  // Uses the format and the index selected via the --edits-format and
+  // --emitted-edits-index cmdline parameters.
+  explicit EditWriter(llvm::raw_ostream* output);
+  EditWriter(llvm::raw_ostream* output,
+             Format format,
+             std::unique_ptr<EmittedEditsIndex> emitted_edits_index);
+  ~EditWriter();
+
+  EditWriter(const EditWriter&) = delete;
+  EditWriter& operator=(const EditWriter&) = delete;
+
+  // Every batch of edits needs to be enclosed in BeginEdits / EndEdits calls.
+  void BeginEdits();
+  void EndEdits();
+
+  void WriteReplacement(const clang::tooling::Replacement& replacement);
+  void WriteIncludeUserHeader(llvm::StringRef file_path,
+                              llvm::StringRef header);
+  void WriteEdit(llvm::StringRef edit_type,
+                 llvm::StringRef file_path,
+                 int offset,
+                 int length,
+                 llvm::StringRef text);
+
+  // Writes an edit that is already formatted as a line of the text format
+  // (e.g. by FormatEdit, for tools that need to sort or dedupe the edits before
+  // writing them).  Returns false if |line| couldn't be parsed.
+  bool WriteFormattedEdit(llvm::StringRef line);
+
+  // Returns the line representing the edit in the text format.
+  static std::string FormatEdit(llvm::StringRef edit_type,
+                                llvm::StringRef file_path,
+                                int offset,
+                                int length,
+                                llvm::StringRef text);
+
+ private:
+  // Returns the index of |str| in the string table, writing a new string table
+  // record first if needed.
+  unsigned InternString(llvm::StringRef str);
+
+  llvm::raw_ostream* const output_;
+  const Format format_;
+  const std::unique_ptr<EmittedEditsIndex> emitted_edits_index_;
+
+  llvm::StringMap<unsigned> string_table_;
+};
+
+#endif  // TOOLS_CLANG_COMMON_EDIT_WRITER_H_
@@ -0,0 +1,125 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "common/EmittedEditsIndex.h"
+
+#include <utility>
+
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
+
+namespace {
+
+using Slot = std::atomic<uint64_t>;
+
+// The slots are shared with other processes, so they need to be plain 64-bit
+// integers that can be updated atomically without any locks (uint64_t has the
+// same size as long long on all the platforms the tools are built for).
+static_assert(sizeof(Slot) == sizeof(uint64_t), "Unexpected atomic size");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Atomic needs to be lock-free");
+
+// Number of slots in a newly created index (takes 128MB of disk space, but
+// untouched pages of the sparse file don't actually use any).
+const size_t kDefaultSlotCount = 1 << 24;
+
+// Slots with this value are empty.  Hashes equal to it are replaced with
+// kEmptySlotReplacement.
+const uint64_t kEmptySlot = 0;
+const uint64_t kEmptySlotReplacement = 1;
+
+// Number of slots to probe before giving up.  An edit that doesn't fit in the
+// index is emitted (i.e. treated as new).
+const size_t kMaxProbes = 64;
+
+}  // namespace
+
+// static
+std::unique_ptr<EmittedEditsIndex> EmittedEditsIndex::Open(
+    llvm::StringRef path,
+    std::string* error) {
+  int fd;
+  std::error_code ec = llvm::sys::fs::openFileForReadWrite(
+      path, fd, llvm::sys::fs::CD_OpenAlways, llvm::sys::fs::OF_None);
+  if (ec) {
+    *error = ec.message();
+    return nullptr;
+  }
+
+  // Another process might be creating the index at the same time, but both
+  // processes resize the file to the same size, so that's fine.
+  llvm::sys::fs::file_status status;
+  uint64_t size = 0;
+  if (!(ec = llvm::sys::fs::status(fd, status))) {
+    size = status.getSize();
+    if (size == 0) {
+      size = kDefaultSlotCount * sizeof(Slot);
+      ec = llvm::sys::fs::resize_file_before_mapping_readwrite(fd, size);
+    } else if (size % sizeof(Slot) != 0) {
+      ec = std::make_error_code(std::errc::invalid_argument);
+    }
+  }
+
+  llvm::sys::fs::mapped_file_region region;
+  if (!ec) {
+    region = llvm::sys::fs::mapped_file_region(
+        llvm::sys::fs::convertFDToNativeFile(fd),
+        llvm::sys::fs::mapped_file_region::readwrite, size, 0, ec);
+  }
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  if (ec) {
+    *error = ec.message();
+    return nullptr;
+  }
+
+  return std::unique_ptr<EmittedEditsIndex>(
+      new EmittedEditsIndex(std::move(region)));
+}
+
+EmittedEditsIndex::EmittedEditsIndex(llvm::sys::fs::mapped_file_region region)
+    : region_(std::move(region)),
+      slots_(reinterpret_cast<Slot*>(region_.data())),
+      slot_count_(region_.size() / sizeof(Slot)) {}
+
+EmittedEditsIndex::~EmittedEditsIndex() = default;
+
+bool EmittedEditsIndex::Insert(llvm::StringRef edit_type,
+                               llvm::StringRef file_path,
+                               int offset,
+                               int length,
+                               llvm::StringRef text) {
+  std::string key =
+      llvm::formatv("{0}:::{1}:::{2:x}:::{3}:::{4}:::", edit_type, file_path,
+                    GetContentHash(file_path), offset, length)
+          .str();
+  key.append(text.begin(), text.end());
+  uint64_t hash = llvm::xxHash64(key);
+  if (hash == kEmptySlot)
+    hash = kEmptySlotReplacement;
+
+  for (size_t i = 0; i < kMaxProbes; ++i) {
+    Slot& slot = slots_[(hash + i) % slot_count_];
+    uint64_t expected = kEmptySlot;
+    if (slot.compare_exchange_strong(expected, hash))
+      return true;
+    if (expected == hash)
+      return false;
+  }
+  return true;
+}
+
+uint64_t EmittedEditsIndex::GetContentHash(llvm::StringRef file_path) {
+  auto it = content_hashes_.find(file_path);
+  if (it != content_hashes_.end())
+    return it->getValue();
+
+  uint64_t content_hash = 0;
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(file_path);
+  if (buffer)
+    content_hash = llvm::xxHash64((*buffer)->getBuffer());
+  content_hashes_.try_emplace(file_path, content_hash);
+  return content_hash;
+}
@@ -0,0 +1,72 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_COMMON_EMITTED_EDITS_INDEX_H_
+#define TOOLS_CLANG_COMMON_EMITTED_EDITS_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+
+// A set of edits that were already emitted, stored in a memory-mapped file so
+// that it is shared by all the tool processes that use the same index file
+// (e.g. the processes spawned by run_tool.py).  This lets tools skip edits of
+// headers that were already processed as part of another translation unit,
+// instead of emitting the same edits once per translation unit that includes
+// the header.
+//
+// The file is a fixed-size open-addressing hash table of 64-bit hashes, which
+// are inserted with atomic compare-and-swap operations.  An edit is identified
+// by its type, its file path, the hash of the file's contents, its offset and
+// length, and the replacement text.  Hash collisions are possible, but
+// extremely unlikely.
+//
+// An index must only be shared by the tool invocations of a single run: a
+// second run over unchanged files would find all its edits in the index and
+// emit nothing.  run_tool.py --skip-duplicate-edits creates a fresh index for
+// every run.  The index also assumes that emitted edits reach the final
+// output.  In particular, run_tool.py drops the output of tool invocations
+// that fail, so the edits they inserted into the index are lost.
+class EmittedEditsIndex {
+ public:
+  // Opens the index at |path|, creating it if needed.  Returns nullptr and sets
+  // |error| on failure.
+  static std::unique_ptr<EmittedEditsIndex> Open(llvm::StringRef path,
+                                                 std::string* error);
+
+  ~EmittedEditsIndex();
+
+  EmittedEditsIndex(const EmittedEditsIndex&) = delete;
+  EmittedEditsIndex& operator=(const EmittedEditsIndex&) = delete;
+
+  // Records the edit in the index.  Returns true if the edit wasn't recorded
+  // before (by this or any other process), i.e. if it should be emitted.
+  bool Insert(llvm::StringRef edit_type,
+              llvm::StringRef file_path,
+              int offset,
+              int length,
+              llvm::StringRef text);
+
+ private:
+  explicit EmittedEditsIndex(llvm::sys::fs::mapped_file_region region);
+
+  // Returns the hash of the contents of |file_path|, or 0 if the file can't be
+  // read.  Memoized, since all the edits of a file need it.
+  uint64_t GetContentHash(llvm::StringRef file_path);
+
+  llvm::sys::fs::mapped_file_region region_;
+  std::atomic<uint64_t>* const slots_;
+  const size_t slot_count_;
+
+  llvm::StringMap<uint64_t> content_hashes_;
+};
+
+#endif  // TOOLS_CLANG_COMMON_EMITTED_EDITS_INDEX_H_
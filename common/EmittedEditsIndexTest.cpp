@@ -0,0 +1,146 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Tests for EmittedEditsIndex.  Each test uses its own index file in a
+// temporary directory, which is removed at the end.
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+
+#include "common/EmittedEditsIndex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+int g_failures = 0;
+
+#define EXPECT_TRUE(condition)                                            \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      llvm::errs() << __FILE__ << ":" << __LINE__ << ": " << current_test \
+                   << ": expected " #condition "\n";                      \
+      g_failures++;                                                       \
+    }                                                                     \
+  } while (false)
+
+// A temporary directory with an edited source file and an index file.
+class TestDirectory {
+ public:
+  TestDirectory() {
+    std::error_code ec =
+        llvm::sys::fs::createUniqueDirectory("emitted-edits-index", dir_);
+    if (ec) {
+      llvm::errs() << "Cannot create a temporary directory: " << ec.message()
+                   << "\n";
+      exit(1);
+    }
+    source_path_ = GetPath("test.h");
+    index_path_ = GetPath("test.index");
+    WriteFile(source_path_, "int m_count;\n");
+  }
+
+  ~TestDirectory() { llvm::sys::fs::remove_directories(dir_); }
+
+  std::string GetPath(llvm::StringRef filename) const {
+    llvm::SmallString<128> path(dir_);
+    llvm::sys::path::append(path, filename);
+    return std::string(path.str());
+  }
+
+  static void WriteFile(const std::string& path, llvm::StringRef contents) {
+    std::error_code ec;
+    llvm::raw_fd_ostream file(path, ec);
+    if (ec) {
+      llvm::errs() << "Cannot write " << path << ": " << ec.message() << "\n";
+      exit(1);
+    }
+    file << contents;
+  }
+
+  std::unique_ptr<EmittedEditsIndex> OpenIndex() const {
+    std::string error;
+    std::unique_ptr<EmittedEditsIndex> index =
+        EmittedEditsIndex::Open(index_path_, &error);
+    if (!index) {
+      llvm::errs() << "Cannot open " << index_path_ << ": " << error << "\n";
+      exit(1);
+    }
+    return index;
+  }
+
+  const std::string& source_path() const { return source_path_; }
+  const std::string& index_path() const { return index_path_; }
+
+ private:
+  llvm::SmallString<128> dir_;
+  std::string source_path_;
+  std::string index_path_;
+};
+
+void TestInsertDuplicate() {
+  const char current_test[] = "TestInsertDuplicate";
+  TestDirectory dir;
+  std::unique_ptr<EmittedEditsIndex> index = dir.OpenIndex();
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 4, 7, "count_"));
+  EXPECT_TRUE(!index->Insert("r", dir.source_path(), 4, 7, "count_"));
+  // Edits that differ in any part of the key are new.
+  EXPECT_TRUE(index->Insert("include-user-header", dir.source_path(), 4, 7,
+                            "count_"));
+  EXPECT_TRUE(index->Insert("r", dir.GetPath("other.h"), 4, 7, "count_"));
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 5, 7, "count_"));
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 4, 6, "count_"));
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 4, 7, "count"));
+}
+
+void TestReopen() {
+  const char current_test[] = "TestReopen";
+  TestDirectory dir;
+  EXPECT_TRUE(dir.OpenIndex()->Insert("r", dir.source_path(), 4, 7, "count_"));
+  // Another process opening the same file sees the entries.
+  std::unique_ptr<EmittedEditsIndex> index = dir.OpenIndex();
+  EXPECT_TRUE(!index->Insert("r", dir.source_path(), 4, 7, "count_"));
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 4, 7, "count"));
+}
+
+void TestModifiedFile() {
+  const char current_test[] = "TestModifiedFile";
+  TestDirectory dir;
+  EXPECT_TRUE(dir.OpenIndex()->Insert("r", dir.source_path(), 4, 7, "count_"));
+  // The content hash of the file is different, so the same edit is new.
+  TestDirectory::WriteFile(dir.source_path(), "int m_count = 0;\n");
+  std::unique_ptr<EmittedEditsIndex> index = dir.OpenIndex();
+  EXPECT_TRUE(index->Insert("r", dir.source_path(), 4, 7, "count_"));
+  EXPECT_TRUE(!index->Insert("r", dir.source_path(), 4, 7, "count_"));
+}
+
+void TestInvalidFileSize() {
+  const char current_test[] = "TestInvalidFileSize";
+  TestDirectory dir;
+  // Not a multiple of the size of a slot.
+  TestDirectory::WriteFile(dir.index_path(), "0123456789ab");
+  std::string error;
+  EXPECT_TRUE(!EmittedEditsIndex::Open(dir.index_path(), &error));
+  EXPECT_TRUE(!error.empty());
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  TestInsertDuplicate();
+  TestReopen();
+  TestModifiedFile();
+  TestInvalidFileSize();
+
+  if (g_failures) {
+    llvm::errs() << g_failures << " expectation(s) failed\n";
+    return 1;
+  }
+  llvm::outs() << "All EmittedEditsIndex tests passed\n";
+  return 0;
+}
@@ -17,6 +17,8 @@
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
 
+#include "common/EditWriter.h"
+
 using namespace clang::ast_matchers;
 using clang::tooling::CommonOptionsParser;
 using clang::tooling::Replacement;
@@ -189,13 +191,11 @@ int main(int argc, const char* argv[]) {
   // serialization and then use clang-apply-replacements, but that would require
   // copying and pasting a larger amount of boilerplate for all Chrome clang
   // tools.
-  llvm::outs() << "==== BEGIN EDITS ====\n";
-  for (const auto& r : replacements) {
-    llvm::outs() << "r:::" << r.getFilePath() << ":::" << r.getOffset()
-                 << ":::" << r.getLength() << ":::" << r.getReplacementText()
-                 << "\n";
-  }
-  llvm::outs() << "==== END EDITS ====\n";
+  EditWriter edit_writer(&llvm::outs());
+  edit_writer.BeginEdits();
+  for (const auto& r : replacements)
+    edit_writer.WriteReplacement(r);
+  edit_writer.EndEdits();
 
   return 0;
 }
@@ -20,6 +20,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetSelect.h"
 
+#include "common/EditWriter.h"
+
 using namespace clang::ast_matchers;
 using clang::tooling::CommonOptionsParser;
 using clang::tooling::Replacement;
@@ -104,14 +106,11 @@ int main(int argc, const char* argv[]) {
     return 0;
 
   // Serialization format is documented in tools/clang/scripts/run_tool.py
-  llvm::outs() << "==== BEGIN EDITS ====\n";
-  for (const auto& r : replacements) {
-    std::string replacement_text = r.getReplacementText().str();
-    std::replace(replacement_text.begin(), replacement_text.end(), '\n', '\0');
-    llvm::outs() << "r:::" << r.getFilePath() << ":::" << r.getOffset()
-                 << ":::" << r.getLength() << ":::" << replacement_text << "\n";
-  }
-  llvm::outs() << "==== END EDITS ====\n";
+  EditWriter edit_writer(&llvm::outs());
+  edit_writer.BeginEdits();
+  for (const auto& r : replacements)
+    edit_writer.WriteReplacement(r);
+  edit_writer.EndEdits();
 
   return 0;
 }
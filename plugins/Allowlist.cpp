@@ -0,0 +1,206 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Allowlist.h"
+
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace chrome_checker {
+
+DirectoryMatcher::DirectoryMatcher() : nodes_(1) {}
+
+void DirectoryMatcher::Add(llvm::StringRef directory) {
+  assert(directory.startswith("/") && "Directory must start with '/'");
+  assert(directory.endswith("/") && "Directory must end with '/'");
+
+  unsigned node = 0;
+  for (char c : directory) {
+    unsigned child = FindChild(node, c);
+    if (!child) {
+      child = nodes_.size();
+      nodes_[node].children.emplace_back(c, child);
+      nodes_.emplace_back();
+    }
+    node = child;
+  }
+  nodes_[node].is_terminal = true;
+}
+
+bool DirectoryMatcher::Matches(llvm::StringRef path) const {
+  if (empty())
+    return false;
+  // Every directory starts with '/', so only walk the trie from those.
+  for (size_t start = path.find('/'); start != llvm::StringRef::npos;
+       start = path.find('/', start + 1)) {
+    unsigned node = 0;
+    for (size_t i = start; i < path.size(); ++i) {
+      node = FindChild(node, path[i]);
+      if (!node)
+        break;
+      if (nodes_[node].is_terminal)
+        return true;
+    }
+  }
+  return false;
+}
+
+unsigned DirectoryMatcher::FindChild(unsigned node, char c) const {
+  for (const auto& child : nodes_[node].children) {
+    if (child.first == c)
+      return child.second;
+  }
+  return 0;
+}
+
+// static
+const Allowlist* Allowlist::GetOrLoad(const std::string& path,
+                                      std::string* error) {
+  static std::mutex mutex;
+  static llvm::StringMap<std::unique_ptr<Allowlist>>* cache =
+      new llvm::StringMap<std::unique_ptr<Allowlist>>();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = cache->find(path);
+  if (it != cache->end())
+    return it->second.get();
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file =
+      llvm::MemoryBuffer::getFile(path);
+  if (!file) {
+    *error = "Cannot open " + path + ": " + file.getError().message();
+    return nullptr;
+  }
+
+  std::unique_ptr<Allowlist> allowlist(new Allowlist());
+  if (!allowlist->Parse((*file)->getMemBufferRef(), error)) {
+    *error = path + ": " + *error;
+    return nullptr;
+  }
+  const Allowlist* result = allowlist.get();
+  (*cache)[path] = std::move(allowlist);
+  return result;
+}
+
+// static
+const Allowlist& Allowlist::GetBuiltin() {
+  static const Allowlist* builtin = [] {
+    Allowlist* allowlist = new Allowlist();
+
+    allowlist->banned_directories_.Add("/third_party/");
+    allowlist->banned_directories_.Add("/native_client/");
+    allowlist->banned_directories_.Add("/breakpad/");
+    allowlist->banned_directories_.Add("/courgette/");
+    allowlist->banned_directories_.Add("/ppapi/");
+    allowlist->banned_directories_.Add("/testing/");
+    allowlist->banned_directories_.Add("/v8/");
+    allowlist->banned_directories_.Add("/frameworks/");
+
+    llvm::StringSet<>& records = allowlist->ignored_record_names_;
+    // Used in really low level threading code that probably shouldn't be out
+    // of lined.
+    records.insert("ThreadLocalBoolean");
+
+    // A complicated pickle derived struct that is all packed integers.
+    records.insert("Header");
+
+    // Part of the GPU system that uses multiple included header
+    // weirdness. Never getting this right.
+    records.insert("Validators");
+
+    // Has a UNIT_TEST only constructor. Isn't *terribly* complex...
+    records.insert("AutocompleteController");
+    records.insert("HistoryURLProvider");
+
+    // Used over in the net unittests. A large enough bundle of integers with 1
+    // non-pod class member. Probably harmless.
+    records.insert("MockTransaction");
+
+    // Used heavily in ui_base_unittests and once in views_unittests. Fixing
+    // this isn't worth the overhead of an additional library.
+    records.insert("TestAnimationDelegate");
+
+    // Part of our public interface that nacl and friends use. (Arguably, this
+    // should mean that this is a higher priority but fixing this looks hard.)
+    records.insert("PluginVersionInfo");
+
+    // Measured performance improvement on cc_perftests. See
+    // https://codereview.chromium.org/11299290/
+    records.insert("QuadF");
+
+    // Ignore IPC::NoParams bases, since these structs are generated via
+    // macros and it makes it difficult to add explicit ctors.
+    allowlist->ignored_base_classes_.insert("IPC::NoParams");
+
+    return allowlist;
+  }();
+  return *builtin;
+}
+
+bool Allowlist::IsSuppressed(llvm::StringRef check,
+                             llvm::StringRef path) const {
+  auto it = suppressions_.find(check);
+  return it != suppressions_.end() && it->second.Matches(path);
+}
+
+bool Allowlist::Parse(llvm::MemoryBufferRef contents, std::string* error) {
+  auto is_valid_directory = [](llvm::StringRef directory) {
+    return directory.size() > 1 && directory.startswith("/") &&
+           directory.endswith("/");
+  };
+
+  for (llvm::line_iterator it(contents, /*SkipBlanks=*/true,
+                              /*CommentMarker=*/'#');
+       !it.is_at_end(); ++it) {
+    llvm::StringRef line = it->trim();
+    if (line.empty())
+      continue;
+
+    llvm::StringRef kind;
+    llvm::StringRef value;
+    std::tie(kind, value) = line.split(' ');
+    value = value.trim();
+    if (value.empty()) {
+      *error = "line " + std::to_string(it.line_number()) +
+               ": missing value for '" + kind.str() + "'";
+      return false;
+    }
+
+    if (kind == "dir") {
+      if (!is_valid_directory(value)) {
+        *error = "line " + std::to_string(it.line_number()) +
+                 ": directory must start and end with '/': " + value.str();
+        return false;
+      }
+      banned_directories_.Add(value);
+    } else if (kind == "record") {
+      ignored_record_names_.insert(value);
+    } else if (kind == "base") {
+      ignored_base_classes_.insert(value);
+    } else if (kind == "suppress") {
+      llvm::StringRef check;
+      llvm::StringRef directory;
+      std::tie(check, directory) = value.split(' ');
+      directory = directory.trim();
+      if (!is_valid_directory(directory)) {
+        *error = "line " + std::to_string(it.line_number()) +
+                 ": expected 'suppress <check> /directory/'";
+        return false;
+      }
+      suppressions_[check].Add(directory);
+    } else {
+      *error = "line " + std::to_string(it.line_number()) +
+               ": unknown entry type '" + kind.str() + "'";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace chrome_checker
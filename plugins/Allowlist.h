@@ -0,0 +1,100 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Lists of directories, records and base classes that the plugin doesn't
+// check, either built in or loaded from a file given with the
+// allowlist-file=<path> plugin argument. The file has one entry per line:
+//
+//   # Comment.
+//   dir /some/directory/
+//   record SomeRecordName
+//   base some::IgnoredBaseClass
+//   suppress <check> /some/directory/
+//
+// Directories must start and end with '/', and match any path that contains
+// them. <check> is one of the names returned by GetCheckName() in
+// FindBadConstructsConsumer.cpp.
+//
+// A file is only parsed once per process, so that the cost of a large list is
+// not paid again for every translation unit that a clang process compiles.
+
+#ifndef TOOLS_CLANG_PLUGINS_ALLOWLIST_H_
+#define TOOLS_CLANG_PLUGINS_ALLOWLIST_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MemoryBufferRef.h"
+
+namespace chrome_checker {
+
+// Matches paths against a set of directories of the form "/a/b/", each of
+// which matches any path containing it. The directories are stored in a trie,
+// which is walked from every '/' in the path, so the cost of a lookup depends
+// on the length of the path rather than on the number of directories.
+class DirectoryMatcher {
+ public:
+  DirectoryMatcher();
+
+  // |directory| must start and end with '/'.
+  void Add(llvm::StringRef directory);
+  bool Matches(llvm::StringRef path) const;
+  bool empty() const { return nodes_.size() == 1; }
+
+ private:
+  struct Node {
+    llvm::SmallVector<std::pair<char, unsigned>, 2> children;
+    bool is_terminal = false;
+  };
+
+  // Returns the index of the child of |node| for |c|, or 0 if there is none.
+  // The root is at index 0, and can't be a child.
+  unsigned FindChild(unsigned node, char c) const;
+
+  std::vector<Node> nodes_;
+};
+
+class Allowlist {
+ public:
+  // Returns the allowlist parsed from |path|, which is loaded the first time it
+  // is requested and cached for the lifetime of the process. Returns null and
+  // sets |error| if the file can't be read or parsed.
+  static const Allowlist* GetOrLoad(const std::string& path,
+                                    std::string* error);
+
+  // Returns the entries that are built into the plugin.
+  static const Allowlist& GetBuiltin();
+
+  bool IsBannedDirectory(llvm::StringRef path) const {
+    return banned_directories_.Matches(path);
+  }
+  bool IsIgnoredRecord(llvm::StringRef name) const {
+    return ignored_record_names_.count(name) > 0;
+  }
+  bool IsIgnoredBaseClass(llvm::StringRef qualified_name) const {
+    return ignored_base_classes_.count(qualified_name) > 0;
+  }
+  // Returns true if diagnostics from |check| should not be emitted for
+  // |path|.
+  bool IsSuppressed(llvm::StringRef check, llvm::StringRef path) const;
+  bool HasSuppressions() const { return !suppressions_.empty(); }
+
+ private:
+  Allowlist() = default;
+
+  bool Parse(llvm::MemoryBufferRef contents, std::string* error);
+
+  DirectoryMatcher banned_directories_;
+  llvm::StringSet<> ignored_record_names_;
+  llvm::StringSet<> ignored_base_classes_;
+  llvm::StringMap<DirectoryMatcher> suppressions_;
+};
+
+}  // namespace chrome_checker
+
+#endif  // TOOLS_CLANG_PLUGINS_ALLOWLIST_H_
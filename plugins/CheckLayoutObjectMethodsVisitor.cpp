@@ -4,10 +4,13 @@
 
 #include "CheckLayoutObjectMethodsVisitor.h"
 
+#include <algorithm>
+
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
+#include "llvm/ADT/DenseMap.h"
 
 using namespace clang::ast_matchers;
 
@@ -63,14 +66,101 @@ class DiagnosticsReporter {
   unsigned diag_layout_object_method_without_is_not_destroyed_check_;
 };
 
+// Returns the real path of |file_entry| with forward slashes, or an empty
+// string if it cannot be determined.
+std::string GetNormalizedRealPath(const clang::FileEntry* file_entry) {
+  if (!file_entry)
+    return std::string();
+  std::string file_name = file_entry->tryGetRealPathName().str();
+#if defined(_WIN32)
+  std::replace(file_name.begin(), file_name.end(), '\\', '/');
+#endif
+  return file_name;
+}
+
+// Returns true if |file_name| is under one of the directories this check
+// applies to.
+bool IsCheckedPath(const std::string& file_name,
+                   const std::string& layout_directory,
+                   const std::string& test_directory) {
+  return file_name.find(layout_directory) != std::string::npos ||
+         file_name.find(test_directory) != std::string::npos;
+}
+
+// Returns true if the translation unit defines blink::LayoutObject. This is a
+// couple of name lookups, so it is much cheaper than running the matchers
+// over the whole AST of translation units that can't contain any
+// LayoutObject methods.
+bool HasLayoutObjectDefinition(clang::ASTContext& context) {
+  clang::IdentifierInfo& blink_name = context.Idents.get("blink");
+  clang::IdentifierInfo& layout_object_name =
+      context.Idents.get("LayoutObject");
+  for (const clang::NamedDecl* blink_decl :
+       context.getTranslationUnitDecl()->lookup(&blink_name)) {
+    const auto* blink_namespace =
+        llvm::dyn_cast<clang::NamespaceDecl>(blink_decl);
+    if (!blink_namespace)
+      continue;
+    for (const clang::NamedDecl* decl :
+         blink_namespace->lookup(&layout_object_name)) {
+      const auto* record = llvm::dyn_cast<clang::CXXRecordDecl>(decl);
+      if (record && record->hasDefinition())
+        return true;
+    }
+  }
+  return false;
+}
+
+// Caches, per FileID, whether declarations in that file are subject to the
+// check, so the path is only resolved once per file.
+class CheckedFileFilter {
+ public:
+  CheckedFileFilter(const clang::SourceManager& source_manager,
+                    const std::string& layout_directory,
+                    const std::string& test_directory)
+      : source_manager_(source_manager),
+        layout_directory_(layout_directory),
+        test_directory_(test_directory) {}
+
+  bool IsInCheckedFile(clang::SourceLocation loc) {
+    clang::FileID file_id =
+        source_manager_.getFileID(source_manager_.getExpansionLoc(loc));
+    auto it = cache_.find(file_id);
+    if (it != cache_.end())
+      return it->second;
+    bool result = IsCheckedPath(
+        GetNormalizedRealPath(source_manager_.getFileEntryForID(file_id)),
+        layout_directory_, test_directory_);
+    cache_.insert({file_id, result});
+    return result;
+  }
+
+ private:
+  const clang::SourceManager& source_manager_;
+  const std::string& layout_directory_;
+  const std::string& test_directory_;
+  llvm::DenseMap<clang::FileID, bool> cache_;
+};
+
+AST_MATCHER_P(clang::Decl,
+              isInCheckedFile,
+              CheckedFileFilter*,
+              filter) {
+  return filter->IsInCheckedFile(Node.getLocation());
+}
+
 class LayoutObjectMethodMatcher : public MatchFinder::MatchCallback {
  public:
-  explicit LayoutObjectMethodMatcher(class DiagnosticsReporter& diagnostics)
-      : diagnostics_(diagnostics) {}
+  LayoutObjectMethodMatcher(class DiagnosticsReporter& diagnostics,
+                            CheckedFileFilter& file_filter)
+      : diagnostics_(diagnostics), file_filter_(file_filter) {}
 
   void Register(MatchFinder& match_finder) {
     const DeclarationMatcher function_call =
         cxxMethodDecl(
+            // Cheap checks first, so that isSameOrDerivedFrom() only runs on
+            // method definitions under the checked directories.
+            isDefinition(), isInCheckedFile(&file_filter_),
             hasParent(
                 cxxRecordDecl(isSameOrDerivedFrom("::blink::LayoutObject"))),
             has(compoundStmt()),
@@ -109,6 +199,7 @@ class LayoutObjectMethodMatcher : public MatchFinder::MatchCallback {
 
  private:
   DiagnosticsReporter& diagnostics_;
+  CheckedFileFilter& file_filter_;
 };
 
 }  // namespace
@@ -119,27 +210,24 @@ CheckLayoutObjectMethodsVisitor::CheckLayoutObjectMethodsVisitor(
 
 void CheckLayoutObjectMethodsVisitor::VisitLayoutObjectMethods(
     clang::ASTContext& ast_context) {
-  const clang::FileEntry* file_entry =
-      ast_context.getSourceManager().getFileEntryForID(
-          ast_context.getSourceManager().getMainFileID());
-  if (!file_entry)
+  const clang::SourceManager& source_manager = ast_context.getSourceManager();
+  std::string file_name = GetNormalizedRealPath(
+      source_manager.getFileEntryForID(source_manager.getMainFileID()));
+  if (file_name.empty())
     return;
-
-  auto file_name_ref = file_entry->tryGetRealPathName();
-  if (file_name_ref.empty())
+  if (!IsCheckedPath(file_name, layout_directory, test_directory))
     return;
-  std::string file_name = file_name_ref.str();
-#if defined(_WIN32)
-  std::replace(file_name.begin(), file_name.end(), '\\', '/');
-#endif
-  if (file_name.find(layout_directory) == std::string::npos &&
-      file_name.find(test_directory) == std::string::npos)
+
+  if (!HasLayoutObjectDefinition(ast_context))
     return;
 
   MatchFinder match_finder;
   DiagnosticsReporter diagnostics(compiler_);
+  CheckedFileFilter file_filter(source_manager, layout_directory,
+                                test_directory);
 
-  LayoutObjectMethodMatcher layout_object_method_matcher(diagnostics);
+  LayoutObjectMethodMatcher layout_object_method_matcher(diagnostics,
+                                                         file_filter);
   layout_object_method_matcher.Register(match_finder);
 
   match_finder.matchAST(ast_context);
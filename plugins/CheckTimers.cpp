@@ -0,0 +1,71 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CheckTimers.h"
+
+#include "llvm/Support/TimeProfiler.h"
+
+namespace chrome_checker {
+
+CheckTimers::CheckTimers()
+    : group_("find-bad-constructs", "Chromium style plugin checks") {
+  for (int i = 0; i < kNumChecks; ++i) {
+    const char* name = GetName(static_cast<Check>(i));
+    timers_[i].init(name, name, group_);
+  }
+}
+
+// The TimerGroup prints the summary table when its last timer is destroyed.
+CheckTimers::~CheckTimers() = default;
+
+// static
+const char* CheckTimers::GetName(Check check) {
+  switch (check) {
+    case kCtorDtorWeight:
+      return "CheckCtorDtorWeight";
+    case kVirtualMethods:
+      return "CheckVirtualMethods";
+    case kRefCountedDtors:
+      return "CheckRefCountedDtors";
+    case kWeakPtrFactoryMembers:
+      return "CheckWeakPtrFactoryMembers";
+    case kEnumMaxValue:
+      return "CheckEnumMaxValue";
+    case kVarDecl:
+      return "CheckVarDecl";
+    case kPerfCopies:
+      return "CheckPerfCopies";
+    case kDevirtualization:
+      return "CheckDevirtualization";
+    case kIPC:
+      return "CheckIPCVisitor";
+    case kLayoutObjectMethods:
+      return "CheckLayoutObjectMethodsVisitor";
+    case kNumChecks:
+      break;
+  }
+  assert(false && "Unknown check");
+  return "";
+}
+
+ScopedCheckTimer::ScopedCheckTimer(CheckTimers* timers,
+                                   CheckTimers::Check check) {
+  if (!timers)
+    return;
+  timer_ = timers->timer(check);
+  timer_->startTimer();
+  if (llvm::getTimeTraceProfilerInstance()) {
+    time_trace_ = true;
+    llvm::timeTraceProfilerBegin(CheckTimers::GetName(check), "");
+  }
+}
+
+ScopedCheckTimer::~ScopedCheckTimer() {
+  if (time_trace_)
+    llvm::timeTraceProfilerEnd();
+  if (timer_)
+    timer_->stopTimer();
+}
+
+}  // namespace chrome_checker
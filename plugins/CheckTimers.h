@@ -0,0 +1,62 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures how much time each check of the plugin takes. Enabled with the
+// time-checks plugin argument: the time spent in each check is then recorded
+// in the -ftime-trace output, and a summary table is printed at the end of the
+// translation unit.
+
+#ifndef TOOLS_CLANG_PLUGINS_CHECKTIMERS_H_
+#define TOOLS_CLANG_PLUGINS_CHECKTIMERS_H_
+
+#include "llvm/Support/Timer.h"
+
+namespace chrome_checker {
+
+class CheckTimers {
+ public:
+  enum Check {
+    kCtorDtorWeight,
+    kVirtualMethods,
+    kRefCountedDtors,
+    kWeakPtrFactoryMembers,
+    kEnumMaxValue,
+    kVarDecl,
+    kPerfCopies,
+    kDevirtualization,
+    kIPC,
+    kLayoutObjectMethods,
+    kNumChecks,
+  };
+
+  CheckTimers();
+  ~CheckTimers();
+
+  static const char* GetName(Check check);
+
+  llvm::Timer* timer(Check check) { return &timers_[check]; }
+
+ private:
+  llvm::TimerGroup group_;
+  llvm::Timer timers_[kNumChecks];
+};
+
+// Measures the time spent in |check| for the lifetime of the object. Does
+// nothing if |timers| is null.
+class ScopedCheckTimer {
+ public:
+  ScopedCheckTimer(CheckTimers* timers, CheckTimers::Check check);
+  ~ScopedCheckTimer();
+
+  ScopedCheckTimer(const ScopedCheckTimer&) = delete;
+  ScopedCheckTimer& operator=(const ScopedCheckTimer&) = delete;
+
+ private:
+  llvm::Timer* timer_ = nullptr;
+  bool time_trace_ = false;
+};
+
+}  // namespace chrome_checker
+
+#endif  // TOOLS_CLANG_PLUGINS_CHECKTIMERS_H_
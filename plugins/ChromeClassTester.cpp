@@ -22,6 +22,7 @@
 #endif
 
 using namespace clang;
+using chrome_checker::Allowlist;
 using chrome_checker::Options;
 
 namespace {
@@ -39,9 +40,9 @@ ChromeClassTester::ChromeClassTester(CompilerInstance& instance,
                                      const Options& options)
     : options_(options),
       instance_(instance),
-      diagnostic_(instance.getDiagnostics()) {
-  BuildBannedLists();
-}
+      diagnostic_(instance.getDiagnostics()),
+      builtin_allowlist_(Allowlist::GetBuiltin()),
+      allowlist_(options.allowlist) {}
 
 ChromeClassTester::~ChromeClassTester() {}
 
@@ -77,7 +78,7 @@ ChromeClassTester::LocationType ChromeClassTester::ClassifyLocation(
     return LocationType::kThirdParty;
 
   std::string filename;
-  if (!GetFilename(loc, &filename)) {
+  if (!GetNormalizedFilename(loc, &filename)) {
     // If the filename cannot be determined, simply treat this as a banned
     // location, instead of going through the full lookup process.
     return LocationType::kThirdParty;
@@ -86,20 +87,9 @@ ChromeClassTester::LocationType ChromeClassTester::ClassifyLocation(
   // We need to special case scratch space; which is where clang does its
   // macro expansion. We explicitly want to allow people to do otherwise bad
   // things through macros that were defined due to third party libraries.
-  if (filename == "<scratch space>")
+  if (filename == "/<scratch space>")
     return LocationType::kThirdParty;
 
-  // Ensure that we can search for patterns of the form "/foo/" even
-  // if we have a relative path like "foo/bar.cc".  We don't expect
-  // this transformed path to exist necessarily.
-  if (filename.front() != '/') {
-    filename.insert(0, 1, '/');
-  }
-
-  // When using distributed cross compilation build tools, file paths can have
-  // separators which differ from ones at this platform. Make them consistent.
-  std::replace(filename.begin(), filename.end(), '\\', '/');
-
   // Don't check autogenerated files. ninja puts them in $OUT_DIR/gen.
   if (filename.find("/gen/") != std::string::npos)
     return LocationType::kThirdParty;
@@ -110,14 +100,11 @@ ChromeClassTester::LocationType ChromeClassTester::ClassifyLocation(
     return LocationType::kBlink;
   }
 
-  for (const std::string& banned_dir : banned_directories_) {
-    // If any of the banned directories occur as a component in filename,
-    // this file is rejected.
-    assert(banned_dir.front() == '/' && "Banned dir must start with '/'");
-    assert(banned_dir.back() == '/' && "Banned dir must end with '/'");
-
-    if (filename.find(banned_dir) != std::string::npos)
-      return LocationType::kThirdParty;
+  // If any of the banned directories occur as a component in filename, this
+  // file is rejected.
+  if (builtin_allowlist_.IsBannedDirectory(filename) ||
+      (allowlist_ && allowlist_->IsBannedDirectory(filename))) {
+    return LocationType::kThirdParty;
   }
 
   return LocationType::kChrome;
@@ -130,8 +117,10 @@ bool ChromeClassTester::HasIgnoredBases(const CXXRecordDecl* record) {
       continue;
 
     const std::string& base_name = base_record->getQualifiedNameAsString();
-    if (ignored_base_classes_.count(base_name) > 0)
+    if (builtin_allowlist_.IsIgnoredBaseClass(base_name) ||
+        (allowlist_ && allowlist_->IsIgnoredBaseClass(base_name))) {
       return true;
+    }
     if (HasIgnoredBases(base_record))
       return true;
   }
@@ -160,54 +149,20 @@ bool ChromeClassTester::InImplementationFile(SourceLocation record_location) {
   return false;
 }
 
-void ChromeClassTester::BuildBannedLists() {
-  banned_directories_.emplace("/third_party/");
-  banned_directories_.emplace("/native_client/");
-  banned_directories_.emplace("/breakpad/");
-  banned_directories_.emplace("/courgette/");
-  banned_directories_.emplace("/ppapi/");
-  banned_directories_.emplace("/testing/");
-  banned_directories_.emplace("/v8/");
-  banned_directories_.emplace("/frameworks/");
-
-  // Used in really low level threading code that probably shouldn't be out of
-  // lined.
-  ignored_record_names_.emplace("ThreadLocalBoolean");
-
-  // A complicated pickle derived struct that is all packed integers.
-  ignored_record_names_.emplace("Header");
-
-  // Part of the GPU system that uses multiple included header
-  // weirdness. Never getting this right.
-  ignored_record_names_.emplace("Validators");
-
-  // Has a UNIT_TEST only constructor. Isn't *terribly* complex...
-  ignored_record_names_.emplace("AutocompleteController");
-  ignored_record_names_.emplace("HistoryURLProvider");
-
-  // Used over in the net unittests. A large enough bundle of integers with 1
-  // non-pod class member. Probably harmless.
-  ignored_record_names_.emplace("MockTransaction");
-
-  // Used heavily in ui_base_unittests and once in views_unittests. Fixing this
-  // isn't worth the overhead of an additional library.
-  ignored_record_names_.emplace("TestAnimationDelegate");
-
-  // Part of our public interface that nacl and friends use. (Arguably, this
-  // should mean that this is a higher priority but fixing this looks hard.)
-  ignored_record_names_.emplace("PluginVersionInfo");
-
-  // Measured performance improvement on cc_perftests. See
-  // https://codereview.chromium.org/11299290/
-  ignored_record_names_.emplace("QuadF");
-
-  // Ignore IPC::NoParams bases, since these structs are generated via
-  // macros and it makes it difficult to add explicit ctors.
-  ignored_base_classes_.emplace("IPC::NoParams");
+bool ChromeClassTester::IsSuppressed(llvm::StringRef check,
+                                     SourceLocation loc) {
+  if (!allowlist_ || !allowlist_->HasSuppressions())
+    return false;
+
+  std::string filename;
+  if (!GetNormalizedFilename(loc, &filename))
+    return false;
+  return allowlist_->IsSuppressed(check, filename);
 }
 
 bool ChromeClassTester::IsIgnoredType(const std::string& base_name) {
-  return ignored_record_names_.find(base_name) != ignored_record_names_.end();
+  return builtin_allowlist_.IsIgnoredRecord(base_name) ||
+         (allowlist_ && allowlist_->IsIgnoredRecord(base_name));
 }
 
 bool ChromeClassTester::GetFilename(SourceLocation loc,
@@ -225,6 +180,24 @@ bool ChromeClassTester::GetFilename(SourceLocation loc,
   return true;
 }
 
+bool ChromeClassTester::GetNormalizedFilename(SourceLocation loc,
+                                              std::string* filename) {
+  if (!GetFilename(loc, filename) || filename->empty())
+    return false;
+
+  // Ensure that we can search for patterns of the form "/foo/" even
+  // if we have a relative path like "foo/bar.cc".  We don't expect
+  // this transformed path to exist necessarily.
+  if (filename->front() != '/') {
+    filename->insert(0, 1, '/');
+  }
+
+  // When using distributed cross compilation build tools, file paths can have
+  // separators which differ from ones at this platform. Make them consistent.
+  std::replace(filename->begin(), filename->end(), '\\', '/');
+  return true;
+}
+
 DiagnosticsEngine::Level ChromeClassTester::getErrorLevel() {
   return diagnostic().getWarningsAsErrors() ? DiagnosticsEngine::Error
                                             : DiagnosticsEngine::Warning;
@@ -5,9 +5,9 @@
 #ifndef TOOLS_CLANG_PLUGINS_CHROMECLASSTESTER_H_
 #define TOOLS_CLANG_PLUGINS_CHROMECLASSTESTER_H_
 
-#include <set>
-#include <vector>
+#include <string>
 
+#include "Allowlist.h"
 #include "Options.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/TypeLoc.h"
@@ -53,12 +53,14 @@ class ChromeClassTester {
   // implementation (.cc, .cpp, .mm) file.
   bool InImplementationFile(clang::SourceLocation location);
 
+  // Utility method for subclasses to check whether diagnostics of |check| are
+  // suppressed at |loc| by the allowlist file.
+  bool IsSuppressed(llvm::StringRef check, clang::SourceLocation loc);
+
   // Options.
   const chrome_checker::Options options_;
 
  private:
-  void BuildBannedLists();
-
   // Filtered versions of tags that are only called with things defined in
   // chrome header files.
   virtual void CheckChromeClass(LocationType location_type,
@@ -73,17 +75,18 @@ class ChromeClassTester {
   // Returns false if the filename could not be determined.
   bool GetFilename(clang::SourceLocation loc, std::string* filename);
 
+  // Like GetFilename(), but the filename always starts with '/' and only uses
+  // '/' as a separator, so that it can be matched against directories.
+  bool GetNormalizedFilename(clang::SourceLocation loc, std::string* filename);
+
   clang::CompilerInstance& instance_;
   clang::DiagnosticsEngine& diagnostic_;
 
-  // List of banned directories.
-  std::set<std::string> banned_directories_;
-
-  // List of types that we don't check.
-  std::set<std::string> ignored_record_names_;
-
-  // List of base classes that we skip when checking complex class ctors/dtors.
-  std::set<std::string> ignored_base_classes_;
+  // Banned directories, types that we don't check, and base classes that we
+  // skip when checking complex class ctors/dtors. The built-in lists are
+  // extended by the optional allowlist file.
+  const chrome_checker::Allowlist& builtin_allowlist_;
+  const chrome_checker::Allowlist* const allowlist_;
 };
 
 #endif  // TOOLS_CLANG_PLUGINS_CHROMECLASSTESTER_H_
@@ -7,6 +7,7 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/Frontend/FrontendPluginRegistry.h"
 
+#include "Allowlist.h"
 #include "FindBadConstructsConsumer.h"
 
 using namespace clang;
@@ -15,6 +16,16 @@ namespace chrome_checker {
 
 namespace {
 
+// Returns true if |arg| has the form "<name>=<value>", and sets |value|.
+bool ParseArgWithValue(llvm::StringRef arg,
+                       llvm::StringRef name,
+                       llvm::StringRef* value) {
+  if (!arg.consume_front(name) || !arg.consume_front("="))
+    return false;
+  *value = arg;
+  return true;
+}
+
 class PluginConsumer : public ASTConsumer {
  public:
   PluginConsumer(CompilerInstance* instance, const Options& options)
@@ -42,6 +53,7 @@ std::unique_ptr<ASTConsumer> FindBadConstructsAction::CreateASTConsumer(
 bool FindBadConstructsAction::ParseArgs(const CompilerInstance& instance,
                                         const std::vector<std::string>& args) {
   bool parsed = true;
+  llvm::StringRef value;
 
   for (size_t i = 0; i < args.size() && parsed; ++i) {
     if (args[i] == "check-base-classes") {
@@ -57,6 +69,25 @@ bool FindBadConstructsAction::ParseArgs(const CompilerInstance& instance,
       options_.checked_ptr_as_trivial_member = true;
     } else if (args[i] == "raw-ptr-template-as-trivial-member") {
       options_.raw_ptr_template_as_trivial_member = true;
+    } else if (args[i] == "check-perf-copies") {
+      options_.check_perf_copies = true;
+    } else if (args[i] == "check-devirtualization") {
+      options_.check_devirtualization = true;
+    } else if (args[i] == "time-checks") {
+      options_.time_checks = true;
+    } else if (ParseArgWithValue(args[i], "allowlist-file", &value)) {
+      std::string error;
+      options_.allowlist = Allowlist::GetOrLoad(value.str(), &error);
+      if (!options_.allowlist) {
+        parsed = false;
+        llvm::errs() << "Cannot load allowlist file: " << error << "\n";
+      }
+    } else if (ParseArgWithValue(args[i], "perf-copies-size-limit", &value)) {
+      if (value.getAsInteger(10, options_.perf_copies_size_limit)) {
+        parsed = false;
+        llvm::errs() << "Invalid value for perf-copies-size-limit: " << value
+                     << "\n";
+      }
     } else {
       parsed = false;
       llvm::errs() << "Unknown clang plugin argument: " << args[i] << "\n";
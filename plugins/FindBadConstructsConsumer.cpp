@@ -4,8 +4,11 @@
 
 #include "FindBadConstructsConsumer.h"
 
+#include <set>
+
 #include "Util.h"
 #include "clang/AST/Attr.h"
+#include "clang/Analysis/Analyses/ExprMutationAnalyzer.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Sema/Sema.h"
@@ -93,6 +96,58 @@ std::set<FunctionDecl*> GetLateParsedFunctionDecls(TranslationUnitDecl* decl) {
   return v.late_parsed_decls;
 }
 
+// Collects the virtual calls on |this| that are made from inside a loop.
+class VirtualCallsInLoopsFinder
+    : public RecursiveASTVisitor<VirtualCallsInLoopsFinder> {
+ public:
+  bool TraverseForStmt(ForStmt* stmt) {
+    ++loop_depth_;
+    bool result = RecursiveASTVisitor::TraverseForStmt(stmt);
+    --loop_depth_;
+    return result;
+  }
+  bool TraverseCXXForRangeStmt(CXXForRangeStmt* stmt) {
+    ++loop_depth_;
+    bool result = RecursiveASTVisitor::TraverseCXXForRangeStmt(stmt);
+    --loop_depth_;
+    return result;
+  }
+  bool TraverseWhileStmt(WhileStmt* stmt) {
+    ++loop_depth_;
+    bool result = RecursiveASTVisitor::TraverseWhileStmt(stmt);
+    --loop_depth_;
+    return result;
+  }
+  bool TraverseDoStmt(DoStmt* stmt) {
+    ++loop_depth_;
+    bool result = RecursiveASTVisitor::TraverseDoStmt(stmt);
+    --loop_depth_;
+    return result;
+  }
+
+  bool VisitCXXMemberCallExpr(CXXMemberCallExpr* call) {
+    if (loop_depth_ == 0)
+      return true;
+    const CXXMethodDecl* callee = call->getMethodDecl();
+    if (!callee || !callee->isVirtual())
+      return true;
+    // Qualified calls such as Base::Foo() are not virtual calls.
+    const auto* member =
+        dyn_cast<MemberExpr>(call->getCallee()->IgnoreParens());
+    if (!member || member->hasQualifier())
+      return true;
+    const Expr* object = call->getImplicitObjectArgument();
+    if (object && isa<CXXThisExpr>(object->IgnoreParenImpCasts()))
+      calls.push_back(call);
+    return true;
+  }
+
+  std::vector<const CXXMemberCallExpr*> calls;
+
+ private:
+  int loop_depth_ = 0;
+};
+
 std::string GetAutoReplacementTypeAsString(QualType type,
                                            StorageClass storage_class) {
   QualType non_reference_type = type.getNonReferenceType();
@@ -120,6 +175,9 @@ std::string GetAutoReplacementTypeAsString(QualType type,
 FindBadConstructsConsumer::FindBadConstructsConsumer(CompilerInstance& instance,
                                                      const Options& options)
     : ChromeClassTester(instance, options) {
+  if (options.time_checks) {
+    check_timers_ = std::make_unique<CheckTimers>();
+  }
   if (options.check_ipc) {
     ipc_visitor_.reset(new CheckIPCVisitor(instance));
   }
@@ -202,6 +260,22 @@ FindBadConstructsConsumer::FindBadConstructsConsumer(CompilerInstance& instance,
                                    "[chromium-style] auto variable type "
                                    "must not deduce to a raw pointer "
                                    "type.");
+  diag_perf_copied_param_ = diagnostic().getCustomDiagID(
+      getErrorLevel(),
+      "[chromium-style] Parameter %0 of type %1 (%2 bytes) is copied but never "
+      "modified; pass it by const reference.");
+  diag_perf_copied_loop_variable_ = diagnostic().getCustomDiagID(
+      getErrorLevel(),
+      "[chromium-style] Loop variable %0 of type %1 (%2 bytes) is copied on "
+      "every iteration but never modified; iterate by const reference.");
+  diag_class_could_be_final_ = diagnostic().getCustomDiagID(
+      getErrorLevel(),
+      "[chromium-style] %0 has virtual methods but no subclasses; mark it "
+      "'final' so that calls to them can be devirtualized.");
+  diag_virtual_call_in_loop_ = diagnostic().getCustomDiagID(
+      getErrorLevel(),
+      "[chromium-style] Virtual call to %0 in a loop could be devirtualized "
+      "if %1 were marked 'final'.");
 
   // Registers notes to make it easier to interpret warnings.
   diag_note_inheritance_ = diagnostic().getCustomDiagID(
@@ -219,50 +293,105 @@ FindBadConstructsConsumer::FindBadConstructsConsumer(CompilerInstance& instance,
 
 void FindBadConstructsConsumer::Traverse(ASTContext& context) {
   if (ipc_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kIPC);
     ipc_visitor_->set_context(&context);
     ParseFunctionTemplates(context.getTranslationUnitDecl());
   }
   if (layout_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(),
+                           CheckTimers::kLayoutObjectMethods);
     layout_visitor_->VisitLayoutObjectMethods(context);
   }
   RecursiveASTVisitor::TraverseDecl(context.getTranslationUnitDecl());
   if (ipc_visitor_) ipc_visitor_->set_context(nullptr);
+  if (options_.check_devirtualization) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kDevirtualization);
+    CheckDevirtualizationCandidates();
+  }
 }
 
 bool FindBadConstructsConsumer::TraverseDecl(Decl* decl) {
-  if (ipc_visitor_) ipc_visitor_->BeginDecl(decl);
+  if (ipc_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kIPC);
+    ipc_visitor_->BeginDecl(decl);
+  }
   bool result = RecursiveASTVisitor::TraverseDecl(decl);
-  if (ipc_visitor_) ipc_visitor_->EndDecl();
+  if (ipc_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kIPC);
+    ipc_visitor_->EndDecl();
+  }
   return result;
 }
 
 bool FindBadConstructsConsumer::VisitEnumDecl(clang::EnumDecl* decl) {
+  ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kEnumMaxValue);
   CheckEnumMaxValue(decl);
   return true;
 }
 
 bool FindBadConstructsConsumer::VisitTagDecl(clang::TagDecl* tag_decl) {
-  if (tag_decl->isCompleteDefinition())
-    CheckTag(tag_decl);
+  if (!tag_decl->isCompleteDefinition())
+    return true;
+  if (options_.check_devirtualization) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kDevirtualization);
+    // Subclasses anywhere (including third-party code) rule out marking their
+    // bases final, so this is done before CheckTag() filters locations.
+    if (auto* record = dyn_cast<CXXRecordDecl>(tag_decl)) {
+      RecordSubclassedBases(record);
+      // The bases of implicit instantiations (e.g. W<Leaf> for
+      // template <class T> struct W : T {}) are only known once the whole
+      // translation unit is parsed, see CheckDevirtualizationCandidates().
+      if (ClassTemplateDecl* class_template =
+              record->getDescribedClassTemplate()) {
+        class_templates_.push_back(class_template);
+      }
+    }
+  }
+  CheckTag(tag_decl);
   return true;
 }
 
 bool FindBadConstructsConsumer::VisitTemplateSpecializationType(
     TemplateSpecializationType* spec) {
-  if (ipc_visitor_) ipc_visitor_->VisitTemplateSpecializationType(spec);
+  if (ipc_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kIPC);
+    ipc_visitor_->VisitTemplateSpecializationType(spec);
+  }
   return true;
 }
 
 bool FindBadConstructsConsumer::VisitCallExpr(CallExpr* call_expr) {
-  if (ipc_visitor_) ipc_visitor_->VisitCallExpr(call_expr);
+  if (ipc_visitor_) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kIPC);
+    ipc_visitor_->VisitCallExpr(call_expr);
+  }
   return true;
 }
 
 bool FindBadConstructsConsumer::VisitVarDecl(clang::VarDecl* var_decl) {
+  ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kVarDecl);
   CheckVarDecl(var_decl);
   return true;
 }
 
+bool FindBadConstructsConsumer::VisitFunctionDecl(
+    clang::FunctionDecl* function_decl) {
+  if (options_.check_perf_copies) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kPerfCopies);
+    CheckPerfCopiedParams(function_decl);
+  }
+  return true;
+}
+
+bool FindBadConstructsConsumer::VisitCXXForRangeStmt(
+    clang::CXXForRangeStmt* for_range) {
+  if (options_.check_perf_copies) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kPerfCopies);
+    CheckPerfCopiedLoopVariable(for_range);
+  }
+  return true;
+}
+
 void FindBadConstructsConsumer::CheckChromeClass(LocationType location_type,
                                                  SourceLocation record_location,
                                                  CXXRecordDecl* record) {
@@ -275,8 +404,10 @@ void FindBadConstructsConsumer::CheckChromeClass(LocationType location_type,
     // If this is a POD or a class template or a type dependent on a
     // templated class, assume there's no ctor/dtor/virtual method
     // optimization that we should do.
-    if (!IsPodOrTemplateType(*record))
+    if (!IsPodOrTemplateType(*record)) {
+      ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kCtorDtorWeight);
       CheckCtorDtorWeight(record_location, record);
+    }
   }
 
   bool warn_on_inline_bodies = !implementation_file;
@@ -285,16 +416,31 @@ void FindBadConstructsConsumer::CheckChromeClass(LocationType location_type,
   // does not always see the "override", so we get false positives.
   // See http://llvm.org/bugs/show_bug.cgi?id=18440 and
   //     http://llvm.org/bugs/show_bug.cgi?id=21942
-  if (!IsPodOrTemplateType(*record))
-    CheckVirtualMethods(record_location, record, warn_on_inline_bodies);
+  if (!IsPodOrTemplateType(*record)) {
+    {
+      ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kVirtualMethods);
+      CheckVirtualMethods(record_location, record, warn_on_inline_bodies);
+    }
+    // Classes defined in implementation files can't be subclassed by other
+    // translation units, so the whole class hierarchy is visible here.
+    if (options_.check_devirtualization && implementation_file) {
+      ScopedCheckTimer timer(check_timers_.get(),
+                             CheckTimers::kDevirtualization);
+      RecordDevirtualizationInfo(record);
+    }
+  }
 
   // TODO(dcheng): This is needed because some of the diagnostics for refcounted
   // classes use DiagnosticsEngine::Report() directly, and there are existing
   // violations in Blink. This should be removed once the checks are
   // modularized.
-  if (location_type != LocationType::kBlink)
+  if (location_type != LocationType::kBlink) {
+    ScopedCheckTimer timer(check_timers_.get(), CheckTimers::kRefCountedDtors);
     CheckRefCountedDtors(record_location, record);
+  }
 
+  ScopedCheckTimer timer(check_timers_.get(),
+                         CheckTimers::kWeakPtrFactoryMembers);
   CheckWeakPtrFactoryMembers(record_location, record);
 }
 
@@ -498,10 +644,51 @@ FindBadConstructsConsumer::ReportIfSpellingLocNotIgnored(
       ignored = true;
     }
   }
+  if (!ignored && IsSuppressed(GetCheckName(diagnostic_id), loc))
+    ignored = true;
   return SuppressibleDiagnosticBuilder(&diagnostic(), loc, diagnostic_id,
                                        ignored);
 }
 
+llvm::StringRef FindBadConstructsConsumer::GetCheckName(
+    unsigned diagnostic_id) const {
+  if (diagnostic_id == diag_no_explicit_ctor_ ||
+      diagnostic_id == diag_no_explicit_copy_ctor_ ||
+      diagnostic_id == diag_inline_complex_ctor_ ||
+      diagnostic_id == diag_no_explicit_dtor_ ||
+      diagnostic_id == diag_inline_complex_dtor_) {
+    return "ctor-dtor-weight";
+  }
+  if (diagnostic_id == diag_method_requires_override_ ||
+      diagnostic_id == diag_redundant_virtual_specifier_ ||
+      diagnostic_id == diag_will_be_redundant_virtual_specifier_ ||
+      diagnostic_id == diag_base_method_virtual_and_final_ ||
+      diagnostic_id == diag_virtual_with_inline_body_) {
+    return "virtual-methods";
+  }
+  // Note that most of the refcounting diagnostics are reported directly, and
+  // can't be suppressed.
+  if (diagnostic_id == diag_refcounted_with_protected_non_virtual_dtor_)
+    return "refcounted-dtors";
+  if (diagnostic_id == diag_weak_ptr_factory_order_)
+    return "weak-ptr-factory";
+  if (diagnostic_id == diag_bad_enum_max_value_ ||
+      diagnostic_id == diag_enum_max_value_unique_) {
+    return "enum-max-value";
+  }
+  if (diagnostic_id == diag_auto_deduced_to_a_pointer_type_)
+    return "auto-raw-pointer";
+  if (diagnostic_id == diag_perf_copied_param_ ||
+      diagnostic_id == diag_perf_copied_loop_variable_) {
+    return "perf-copies";
+  }
+  if (diagnostic_id == diag_class_could_be_final_ ||
+      diagnostic_id == diag_virtual_call_in_loop_) {
+    return "devirtualization";
+  }
+  return "";
+}
+
 // Checks that virtual methods are correctly annotated, and have no body in a
 // header file.
 void FindBadConstructsConsumer::CheckVirtualMethods(
@@ -671,6 +858,80 @@ void FindBadConstructsConsumer::CheckVirtualBodies(
   }
 }
 
+// Remembers |record| as a candidate for being marked final if it is a
+// concrete, non-final polymorphic class.
+void FindBadConstructsConsumer::RecordDevirtualizationInfo(
+    CXXRecordDecl* record) {
+  if (!record->getIdentifier() || record->isUnion() || record->isLambda())
+    return;
+  if (!record->isPolymorphic() || record->isAbstract() ||
+      record->hasAttr<FinalAttr>()) {
+    return;
+  }
+  if (IsGmockObject(record))
+    return;
+  devirtualization_candidates_.push_back(record);
+}
+
+// Remembers the bases of |record| as classes that have a subclass.
+void FindBadConstructsConsumer::RecordSubclassedBases(
+    const CXXRecordDecl* record) {
+  for (const CXXBaseSpecifier& base : record->bases()) {
+    if (const CXXRecordDecl* base_record =
+            base.getType()->getAsCXXRecordDecl()) {
+      records_with_subclasses_.insert(base_record->getCanonicalDecl());
+    }
+  }
+}
+
+// Reports the candidates collected by RecordDevirtualizationInfo() that turned
+// out not to have any subclass in the translation unit, along with the virtual
+// calls in loops that their methods make on |this|.
+void FindBadConstructsConsumer::CheckDevirtualizationCandidates() {
+  SourceManager& manager = instance().getSourceManager();
+  const LangOptions& lang_opts = instance().getLangOpts();
+
+  // The traversal doesn't visit implicit instantiations of class templates,
+  // whose bases may depend on template arguments.
+  for (const ClassTemplateDecl* class_template : class_templates_) {
+    for (const ClassTemplateSpecializationDecl* specialization :
+         class_template->specializations()) {
+      if (specialization->hasDefinition())
+        RecordSubclassedBases(specialization);
+    }
+  }
+
+  for (CXXRecordDecl* record : devirtualization_candidates_) {
+    if (records_with_subclasses_.count(record->getCanonicalDecl()))
+      continue;
+
+    SourceLocation name_loc = record->getLocation();
+    FixItHint fix_it;
+    if (!name_loc.isMacroID()) {
+      fix_it = FixItHint::CreateInsertion(
+          Lexer::getLocForEndOfToken(name_loc, 0, manager, lang_opts),
+          " final");
+    }
+    ReportIfSpellingLocNotIgnored(name_loc, diag_class_could_be_final_)
+        << record << fix_it;
+
+    VirtualCallsInLoopsFinder finder;
+    for (CXXMethodDecl* method : record->methods()) {
+      const FunctionDecl* definition = nullptr;
+      if (method->hasBody(definition))
+        finder.TraverseStmt(definition->getBody());
+    }
+    for (const CXXMemberCallExpr* call : finder.calls) {
+      ReportIfSpellingLocNotIgnored(call->getExprLoc(),
+                                    diag_virtual_call_in_loop_)
+          << call->getMethodDecl() << record;
+    }
+  }
+  devirtualization_candidates_.clear();
+  records_with_subclasses_.clear();
+  class_templates_.clear();
+}
+
 void FindBadConstructsConsumer::CountType(const Type* type,
                                           int* trivial_member,
                                           int* non_trivial_member,
@@ -1084,4 +1345,157 @@ void FindBadConstructsConsumer::CheckVarDecl(clang::VarDecl* var_decl) {
   }
 }
 
+// Returns true if copying a value of |type| runs user code (so it can't be a
+// memcpy) and the type is larger than the configured size limit. |size| is set
+// to the size of the type in bytes.
+bool FindBadConstructsConsumer::IsExpensiveToCopy(QualType type,
+                                                  uint64_t* size) {
+  if (type->isDependentType() || type->isReferenceType())
+    return false;
+  const CXXRecordDecl* record = type->getAsCXXRecordDecl();
+  if (!record || !record->hasDefinition())
+    return false;
+  record = record->getDefinition();
+
+  ASTContext& context = instance().getASTContext();
+  if (type.isTriviallyCopyableType(context))
+    return false;
+
+  // Move-only types such as std::unique_ptr<> are taken by value to transfer
+  // ownership, and a const reference wouldn't compile in the callers anyway.
+  bool has_usable_copy_ctor = false;
+  if (record->needsImplicitCopyConstructor()) {
+    has_usable_copy_ctor = !record->defaultedCopyConstructorIsDeleted();
+  } else {
+    for (const CXXConstructorDecl* ctor : record->ctors()) {
+      if (ctor->isCopyConstructor() && !ctor->isDeleted()) {
+        has_usable_copy_ctor = true;
+        break;
+      }
+    }
+  }
+  if (!has_usable_copy_ctor)
+    return false;
+
+  *size = context.getTypeSizeInChars(type).getQuantity();
+  return *size > options_.perf_copies_size_limit;
+}
+
+// Returns a fix-it that turns the declared type of |decl| into a const
+// reference.
+FixItHint FindBadConstructsConsumer::CreateConstRefFixIt(const VarDecl* decl) {
+  // As in CheckVarDecl(), the range starts at the beginning of |decl| to
+  // include any cv qualifiers, and ends where its type ends.
+  CharSourceRange range = CharSourceRange::getTokenRange(
+      decl->getBeginLoc(), decl->getTypeSourceInfo()->getTypeLoc().getEndLoc());
+  if (range.getBegin().isMacroID() || range.getEnd().isMacroID())
+    return FixItHint();
+
+  bool invalid = false;
+  StringRef written_type = Lexer::getSourceText(
+      range, instance().getSourceManager(), instance().getLangOpts(), &invalid);
+  if (invalid)
+    return FixItHint();
+
+  std::string replacement;
+  if (!decl->getType().isConstQualified())
+    replacement = "const ";
+  replacement += written_type.str();
+  replacement += "&";
+  return FixItHint::CreateReplacement(range, replacement);
+}
+
+// Checks for parameters of expensive to copy types that are passed by value,
+// but never modified (including being moved from) in the function body or in
+// constructor member initializers.
+void FindBadConstructsConsumer::CheckPerfCopiedParams(
+    FunctionDecl* function_decl) {
+  if (!function_decl->doesThisDeclarationHaveABody() ||
+      function_decl->isImplicit() || function_decl->isDefaulted() ||
+      function_decl->isDeleted() || function_decl->isDependentContext() ||
+      function_decl->isTemplateInstantiation()) {
+    return;
+  }
+  if (const auto* method = dyn_cast<CXXMethodDecl>(function_decl)) {
+    // The signature of virtual methods is dictated by the overridden methods,
+    // and copy-assignment operators taking their argument by value are
+    // usually the copy-and-swap idiom.
+    if (method->isVirtual() || method->isCopyAssignmentOperator())
+      return;
+  }
+  if (ClassifyLocation(function_decl->getLocation()) ==
+      LocationType::kThirdParty) {
+    return;
+  }
+
+  // Unlike an ExprMutationAnalyzer over the body, this also looks at the
+  // member initializers of constructors (e.g. |s_(std::move(s))|).
+  FunctionParmMutationAnalyzer analyzer(*function_decl,
+                                        instance().getASTContext());
+
+  for (unsigned i = 0; i < function_decl->getNumParams(); ++i) {
+    const ParmVarDecl* param = function_decl->getParamDecl(i);
+    // Unnamed parameters are unused, and typically only exist to satisfy an
+    // interface.
+    if (!param->getIdentifier())
+      continue;
+
+    uint64_t size = 0;
+    if (!IsExpensiveToCopy(param->getType(), &size))
+      continue;
+    if (analyzer.isMutated(param))
+      continue;
+
+    auto builder = ReportIfSpellingLocNotIgnored(param->getBeginLoc(),
+                                                 diag_perf_copied_param_);
+    builder << param << param->getType() << static_cast<unsigned>(size);
+    // Every redeclaration of the function needs to be updated, not just the
+    // definition.
+    for (const FunctionDecl* redecl : function_decl->redecls()) {
+      if (i < redecl->getNumParams())
+        builder << CreateConstRefFixIt(redecl->getParamDecl(i));
+    }
+  }
+}
+
+// Checks for range-based for loops that copy an expensive to copy element on
+// every iteration, and never modify the copy.
+void FindBadConstructsConsumer::CheckPerfCopiedLoopVariable(
+    CXXForRangeStmt* for_range) {
+  const VarDecl* loop_var = for_range->getLoopVariable();
+  if (!loop_var || loop_var->getType()->isDependentType())
+    return;
+
+  // Only report actual copies of elements: if the element is produced by
+  // value (e.g. a proxy or a generated value), binding a const reference to it
+  // doesn't save anything.
+  const auto* construct =
+      dyn_cast_or_null<CXXConstructExpr>(loop_var->getInit());
+  if (!construct || !construct->getConstructor()->isCopyConstructor() ||
+      construct->getNumArgs() < 1) {
+    return;
+  }
+  const Expr* source = construct->getArg(0)->IgnoreImpCasts();
+  if (isa<MaterializeTemporaryExpr>(source) ||
+      isa<CXXBindTemporaryExpr>(source)) {
+    return;
+  }
+
+  uint64_t size = 0;
+  if (!IsExpensiveToCopy(loop_var->getType(), &size))
+    return;
+  if (ClassifyLocation(loop_var->getLocation()) == LocationType::kThirdParty)
+    return;
+
+  ExprMutationAnalyzer analyzer(*for_range->getBody(),
+                                instance().getASTContext());
+  if (analyzer.isMutated(loop_var))
+    return;
+
+  ReportIfSpellingLocNotIgnored(loop_var->getBeginLoc(),
+                                diag_perf_copied_loop_variable_)
+      << loop_var << loop_var->getType() << static_cast<unsigned>(size)
+      << CreateConstRefFixIt(loop_var);
+}
+
 }  // namespace chrome_checker
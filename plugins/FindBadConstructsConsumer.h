@@ -16,11 +16,16 @@
 //   member.
 // - Enum types with a xxxx_LAST or xxxxLast const actually have that constant
 //   have the maximal value for that type.
+// - (Opt-in) Parameters and range-based for loop variables of expensive to
+//   copy types that are taken by value but never modified.
+// - (Opt-in) Polymorphic classes in implementation files without subclasses,
+//   which could be marked final, and virtual calls in loops on such classes.
 
 #ifndef TOOLS_CLANG_PLUGINS_FINDBADCONSTRUCTSCONSUMER_H_
 #define TOOLS_CLANG_PLUGINS_FINDBADCONSTRUCTSCONSUMER_H_
 
 #include <memory>
+#include <vector>
 
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTConsumer.h"
@@ -30,9 +35,11 @@
 #include "clang/AST/TypeLoc.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseSet.h"
 
 #include "CheckIPCVisitor.h"
 #include "CheckLayoutObjectMethodsVisitor.h"
+#include "CheckTimers.h"
 #include "ChromeClassTester.h"
 #include "Options.h"
 #include "SuppressibleDiagnosticBuilder.h"
@@ -54,6 +61,8 @@ class FindBadConstructsConsumer
   bool VisitEnumDecl(clang::EnumDecl* enum_decl);
   bool VisitTagDecl(clang::TagDecl* tag_decl);
   bool VisitVarDecl(clang::VarDecl* var_decl);
+  bool VisitFunctionDecl(clang::FunctionDecl* function_decl);
+  bool VisitCXXForRangeStmt(clang::CXXForRangeStmt* for_range);
   bool VisitTemplateSpecializationType(clang::TemplateSpecializationType* spec);
   bool VisitCallExpr(clang::CallExpr* call_expr);
 
@@ -78,11 +87,18 @@ class FindBadConstructsConsumer
       clang::SourceLocation loc,
       unsigned diagnostic_id);
 
+  // Returns the name of the check that emits |diagnostic_id|, as used in the
+  // suppress entries of the allowlist file.
+  llvm::StringRef GetCheckName(unsigned diagnostic_id) const;
+
   void CheckVirtualMethods(clang::SourceLocation record_location,
                            clang::CXXRecordDecl* record,
                            bool warn_on_inline_bodies);
   void CheckVirtualSpecifiers(const clang::CXXMethodDecl* method);
   void CheckVirtualBodies(const clang::CXXMethodDecl* method);
+  void RecordDevirtualizationInfo(clang::CXXRecordDecl* record);
+  void RecordSubclassedBases(const clang::CXXRecordDecl* record);
+  void CheckDevirtualizationCandidates();
 
   void CountType(const clang::Type* type,
                  int* trivial_member,
@@ -107,6 +123,11 @@ class FindBadConstructsConsumer
   void CheckEnumMaxValue(clang::EnumDecl* decl);
   void CheckVarDecl(clang::VarDecl* decl);
 
+  bool IsExpensiveToCopy(clang::QualType type, uint64_t* size);
+  clang::FixItHint CreateConstRefFixIt(const clang::VarDecl* decl);
+  void CheckPerfCopiedParams(clang::FunctionDecl* function_decl);
+  void CheckPerfCopiedLoopVariable(clang::CXXForRangeStmt* for_range);
+
   void ParseFunctionTemplates(clang::TranslationUnitDecl* decl);
 
   unsigned diag_method_requires_override_;
@@ -126,13 +147,29 @@ class FindBadConstructsConsumer
   unsigned diag_bad_enum_max_value_;
   unsigned diag_enum_max_value_unique_;
   unsigned diag_auto_deduced_to_a_pointer_type_;
+  unsigned diag_perf_copied_param_;
+  unsigned diag_perf_copied_loop_variable_;
+  unsigned diag_class_could_be_final_;
+  unsigned diag_virtual_call_in_loop_;
   unsigned diag_note_inheritance_;
   unsigned diag_note_implicit_dtor_;
   unsigned diag_note_public_dtor_;
   unsigned diag_note_protected_non_virtual_dtor_;
 
+  // Only set with the time-checks argument.
+  std::unique_ptr<CheckTimers> check_timers_;
+
   std::unique_ptr<CheckIPCVisitor> ipc_visitor_;
   std::unique_ptr<CheckLayoutObjectMethodsVisitor> layout_visitor_;
+
+  // Polymorphic classes in implementation files that may be marked final, if
+  // no subclass is found by the end of the translation unit.
+  std::vector<clang::CXXRecordDecl*> devirtualization_candidates_;
+  // Canonical declarations of all classes that have a subclass in the
+  // translation unit.
+  llvm::DenseSet<const clang::CXXRecordDecl*> records_with_subclasses_;
+  // Class templates, whose instantiations may also subclass the candidates.
+  std::vector<const clang::ClassTemplateDecl*> class_templates_;
 };
 
 }  // namespace chrome_checker
@@ -7,6 +7,8 @@
 
 namespace chrome_checker {
 
+class Allowlist;
+
 struct Options {
   bool check_base_classes = false;
   bool check_ipc = false;
@@ -14,6 +16,15 @@ struct Options {
   bool check_layout_object_methods = false;
   bool checked_ptr_as_trivial_member = false;
   bool raw_ptr_template_as_trivial_member = false;
+  bool check_perf_copies = false;
+  bool check_devirtualization = false;
+  bool time_checks = false;
+  // Loaded from the allowlist-file argument. Owned by Allowlist's cache, which
+  // lives until the end of the process.
+  const Allowlist* allowlist = nullptr;
+  // Only types strictly larger than this many bytes are reported by
+  // check_perf_copies.
+  unsigned perf_copies_size_limit = 0;
 };
 
 }  // namespace chrome_checker
@@ -0,0 +1,17 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "allowlist/suppressed.h"
+
+// Listed as a record entry in the allowlist, so this should not warn.
+class AllowlistedRecord : public Base {
+ public:
+  void F() {}
+};
+
+// Should warn.
+class NotAllowlisted : public Base {
+ public:
+  void F() {}
+};
@@ -0,0 +1,19 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_PLUGINS_TESTS_ALLOWLIST_SUPPRESSED_H_
+#define TOOLS_CLANG_PLUGINS_TESTS_ALLOWLIST_SUPPRESSED_H_
+
+class Base {
+ public:
+  virtual void F();
+};
+
+// The virtual-methods check is suppressed in this directory.
+class Suppressed : public Base {
+ public:
+  void F() {}
+};
+
+#endif  // TOOLS_CLANG_PLUGINS_TESTS_ALLOWLIST_SUPPRESSED_H_
@@ -0,0 +1,62 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+class Base {
+ public:
+  virtual ~Base();
+  virtual int Get() const;
+};
+
+// Has a subclass below, so this should not warn.
+class Middle : public Base {
+ public:
+  int Get() const override;
+};
+
+// Should warn: there are no subclasses.
+class Leaf : public Middle {
+ public:
+  int Get() const override;
+  int Sum(int n) const;
+};
+
+// Already final.
+class AlreadyFinal final : public Base {
+ public:
+  int Get() const override;
+};
+
+// Abstract classes need a subclass to be of any use.
+class Abstract {
+ public:
+  virtual int Get() const = 0;
+};
+
+// Not polymorphic.
+class NonVirtual {
+ public:
+  int Get() const;
+};
+
+int Leaf::Sum(int n) const {
+  int sum = 0;
+  for (int i = 0; i < n; ++i)
+    sum += Get();  // Should warn.
+  sum += Get();    // Not in a loop.
+  while (sum > 100)
+    sum -= Middle::Get();  // Qualified, so not a virtual call.
+  return sum;
+}
+
+// Only subclassed through the dependent base of a template instantiation, so
+// this should not warn.
+class SubclassedByTemplate : public Base {
+ public:
+  int Get() const override;
+};
+
+template <class T>
+class Wrapper : public T {};
+
+Wrapper<SubclassedByTemplate> wrapper;
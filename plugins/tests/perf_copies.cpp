@@ -0,0 +1,116 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+class Expensive {
+ public:
+  Expensive();
+  Expensive(const Expensive& other);
+  ~Expensive();
+
+  int Get() const { return data_[0]; }
+  void Set(int value) { data_[0] = value; }
+
+ private:
+  int data_[16];
+};
+
+// Non-trivially copyable, but below the size limit.
+class Small {
+ public:
+  Small();
+  Small(const Small& other);
+  ~Small();
+
+ private:
+  int data_;
+};
+
+class MoveOnly {
+ public:
+  MoveOnly();
+  MoveOnly(MoveOnly&& other);
+  ~MoveOnly();
+
+ private:
+  int data_[16];
+};
+
+struct Trivial {
+  int data[16];
+};
+
+struct Container {
+  const Expensive* begin() const;
+  const Expensive* end() const;
+};
+
+// Should warn.
+int ReadOnly(Expensive expensive) {
+  return expensive.Get();
+}
+
+// Should warn, and keep the existing const.
+int ConstReadOnly(const Expensive expensive) {
+  return expensive.Get();
+}
+
+// Modifies the copy, so it is needed.
+int Modified(Expensive expensive) {
+  expensive.Set(1);
+  return expensive.Get();
+}
+
+// None of these should warn.
+int SmallType(Small small) {
+  return 0;
+}
+int MoveOnlyType(MoveOnly move_only) {
+  return 0;
+}
+int TrivialType(Trivial trivial) {
+  return trivial.data[0];
+}
+int Unnamed(Expensive) {
+  return 0;
+}
+int ByReference(const Expensive& expensive) {
+  return expensive.Get();
+}
+
+int Loops(const Container& container) {
+  int sum = 0;
+  // Should warn.
+  for (auto element : container)
+    sum += element.Get();
+  // Modifies the copy, so it is needed.
+  for (Expensive element : container) {
+    element.Set(sum);
+    sum += element.Get();
+  }
+  // Should not warn.
+  for (const auto& element : container)
+    sum += element.Get();
+  return sum;
+}
+
+class Movable {
+ public:
+  Movable();
+  Movable(const Movable& other);
+  Movable(Movable&& other);
+  ~Movable();
+
+ private:
+  int data_[16];
+};
+
+// Moves the parameter in a member initializer, so it is needed.
+class Sink {
+ public:
+  explicit Sink(Movable movable)
+      : movable_(static_cast<Movable&&>(movable)) {}
+
+ private:
+  Movable movable_;
+};
@@ -22,14 +22,46 @@
 //    can be used to perform the actual rewrite via extract_edits.py and
 //    apply_edits.py.
 //
+// The rewriter can process many translation units in a single process - for
+// example when run with --executor=all-TUs --execute-concurrency=N (and -p
+// pointing at the build directory) instead of once per file via run_tool.py.
+// The output of each translation unit is written as soon as the translation
+// unit is done, and lines that were already written for an earlier
+// translation unit (e.g. edits of a shared header) are not repeated.
+//
+// Alternatively, both kinds of output can be generated in a single pass, by
+// running the rewriter once with --single-pass.  In this mode, instead of the
+// EDITS section, the rewriter emits a FIELD EDITS section, where each edit is
+// prefixed with the qualified name of the field it belongs to.  The output of
+// all translation units should then be piped through
+// merge_single_pass_output.py, which drops the edits of the fields that ended
+// up in any FIELD FILTERS section, and emits the remaining edits in the format
+// expected by apply_edits.py.
+//
+// To avoid reprocessing all translation units after small changes (e.g. after
+// a rebase), the rewriter can be run with --emit-dependencies, which adds a
+// DEPENDENCIES section listing the files read by each translation unit.  Given
+// the output of such a run and a list of changed files, incremental.py finds
+// the translation units that need to be processed again, and merges the output
+// of processing them into the output of the previous run.
+//
+// When run with --stats, the rewriter also prints (to stderr) the number of
+// matches, edits and filters produced by each matcher, together with the time
+// spent in each matcher, summed over all the processed translation units.
+//
 // For more details, see the doc here:
 // https://docs.google.com/document/d/1chTvr3fSofQNV_PDPEHRyUgcJCQBgTDOOBriW9gIm9M
 
 #include <assert.h>
 #include <algorithm>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "clang/AST/ASTContext.h"
@@ -45,9 +77,10 @@
 #include "clang/Lex/MacroArgs.h"
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Tooling/Execution.h"
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorOr.h"
@@ -56,6 +89,9 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+
+#include "common/EditWriter.h"
 
 using namespace clang::ast_matchers;
 
@@ -81,6 +117,26 @@ const char kExcludeFieldsParamName[] = "exclude-fields";
 // - PathFilterFile
 const char kExcludePathsParamName[] = "exclude-paths";
 
+// Name of a cmdline parameter that switches the rewriter into emitting edits
+// keyed by field names (FIELD EDITS) instead of plain EDITS.
+//
+// See also:
+// - OutputHelper::AddReplacement
+const char kSinglePassParamName[] = "single-pass";
+
+// Name of a cmdline parameter that enables emitting the DEPENDENCIES section
+// (used by incremental.py).
+//
+// See also:
+// - OutputHelper::AddDependencies
+const char kEmitDependenciesParamName[] = "emit-dependencies";
+
+// Name of a cmdline parameter that enables printing per-matcher statistics.
+//
+// See also:
+// - StatsCollector
+const char kStatsParamName[] = "stats";
+
 // OutputSectionHelper helps gather and emit a section of output.
 //
 // The section of output is delimited in a way that makes it easy to extract it
@@ -121,31 +177,46 @@ class OutputSectionHelper {
       tags.insert(tag);
   }
 
-  void Emit() {
-    if (output_line_to_tags_.empty())
+  // Writes the section to |out|, skipping lines that are already present in
+  // |emitted_lines| (and adding the newly written lines to it).  Nothing is
+  // written if there are no new lines.
+  void Emit(llvm::raw_ostream& out, llvm::StringSet<>* emitted_lines) const {
+    std::vector<std::string> new_lines = GetNewLines(emitted_lines);
+    if (new_lines.empty())
       return;
 
-    llvm::outs() << "==== BEGIN " << output_delimiter_ << " ====\n";
+    out << "==== BEGIN " << output_delimiter_ << " ====\n";
+    for (const std::string& line : new_lines)
+      out << line << "\n";
+    out << "==== END " << output_delimiter_ << " ====\n";
+  }
+
+  // Returns the sorted output lines (including their comment tags) that are
+  // not yet present in |emitted_lines|, and adds them to |emitted_lines|.
+  std::vector<std::string> GetNewLines(llvm::StringSet<>* emitted_lines) const {
+    std::vector<std::string> new_lines;
     for (const llvm::StringRef& output_line :
          GetSortedKeys(output_line_to_tags_)) {
-      llvm::outs() << output_line;
+      std::string line = output_line.str();
 
-      const llvm::StringSet<>& tags = output_line_to_tags_[output_line];
+      const llvm::StringSet<>& tags =
+          output_line_to_tags_.find(output_line)->second;
       if (!tags.empty()) {
         std::vector<llvm::StringRef> sorted_tags = GetSortedKeys(tags);
         std::string tags_comment =
             llvm::join(sorted_tags.begin(), sorted_tags.end(), ", ");
-        llvm::outs() << "  # " << tags_comment;
+        line += "  # " + tags_comment;
       }
 
-      llvm::outs() << "\n";
+      if (emitted_lines->insert(line).second)
+        new_lines.push_back(std::move(line));
     }
-    llvm::outs() << "==== END " << output_delimiter_ << " ====\n";
+    return new_lines;
   }
 
  private:
   template <typename TValue>
-  std::vector<llvm::StringRef> GetSortedKeys(
+  static std::vector<llvm::StringRef> GetSortedKeys(
       const llvm::StringMap<TValue>& map) {
     std::vector<llvm::StringRef> sorted(map.keys().begin(), map.keys().end());
     std::sort(sorted.begin(), sorted.end());
@@ -156,17 +227,94 @@ class OutputSectionHelper {
   llvm::StringMap<llvm::StringSet<>> output_line_to_tags_;
 };
 
+// Writes the output of all the translation units processed by this process to
+// stdout.  Translation units may be processed concurrently (e.g. when using
+// --executor=all-TUs), so the output of a translation unit is written as a
+// whole, under |lock_|.  Lines that were already written for an earlier
+// translation unit are not repeated.
+//
+// See also:
+// - OutputHelper
+class OutputWriter {
+ public:
+  OutputWriter(bool is_single_pass, bool should_emit_dependencies)
+      : is_single_pass_(is_single_pass),
+        should_emit_dependencies_(should_emit_dependencies),
+        edit_writer_(&llvm::outs()) {}
+
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator=(const OutputWriter&) = delete;
+
+  // Whether edits should be keyed by field names (see --single-pass).
+  bool is_single_pass() const { return is_single_pass_; }
+
+  // Whether the files read by translation units should be emitted (see
+  // --emit-dependencies).
+  bool should_emit_dependencies() const { return should_emit_dependencies_; }
+
+  void Write(const OutputSectionHelper& edits,
+             const OutputSectionHelper& field_edits,
+             const OutputSectionHelper& field_decl_filters,
+             const OutputSectionHelper& dependencies) {
+    std::lock_guard<std::mutex> guard(lock_);
+    WriteEdits(edits);
+    field_edits.Emit(llvm::outs(), &emitted_field_edits_);
+    field_decl_filters.Emit(llvm::outs(), &emitted_field_decl_filters_);
+    dependencies.Emit(llvm::outs(), &emitted_dependencies_);
+    llvm::outs().flush();
+  }
+
+ private:
+  // Unlike the other sections, EDITS are written via EditWriter, so that they
+  // can also be written in the binary format (see --edits-format).
+  void WriteEdits(const OutputSectionHelper& edits) {
+    std::vector<std::string> new_edits = edits.GetNewLines(&emitted_edits_);
+    if (new_edits.empty())
+      return;
+
+    edit_writer_.BeginEdits();
+    for (const std::string& edit : new_edits) {
+      bool success = edit_writer_.WriteFormattedEdit(edit);
+      assert(success && "edits should be formatted by EditWriter::FormatEdit");
+      (void)success;
+    }
+    edit_writer_.EndEdits();
+  }
+
+  const bool is_single_pass_;
+  const bool should_emit_dependencies_;
+
+  std::mutex lock_;
+  EditWriter edit_writer_;
+  llvm::StringSet<> emitted_edits_;
+  llvm::StringSet<> emitted_field_edits_;
+  llvm::StringSet<> emitted_field_decl_filters_;
+  llvm::StringSet<> emitted_dependencies_;
+};
+
+// Gathers the output of a single translation unit and hands it over to the
+// OutputWriter once the translation unit is done.
+//
 // Output format is documented in //docs/clang_tool_refactoring.md
-class OutputHelper : public clang::tooling::SourceFileCallbacks {
+class OutputHelper {
  public:
-  OutputHelper()
-      : edits_helper_("EDITS"), field_decl_filter_helper_("FIELD FILTERS") {}
+  explicit OutputHelper(OutputWriter* output_writer)
+      : output_writer_(output_writer),
+        edits_helper_("EDITS"),
+        field_edits_helper_("FIELD EDITS"),
+        field_decl_filter_helper_("FIELD FILTERS"),
+        dependencies_helper_("DEPENDENCIES") {}
   ~OutputHelper() = default;
 
   OutputHelper(const OutputHelper&) = delete;
   OutputHelper& operator=(const OutputHelper&) = delete;
 
-  void AddReplacement(const clang::SourceManager& source_manager,
+  // Adds an edit needed to rewrite |field_decl|.  In --single-pass mode the
+  // edit is emitted as a FIELD EDITS line prefixed with the qualified name of
+  // |field_decl|, like:
+  //     ns::MyStruct::ptr_field_:::r:::path/to/file.h:::123:::4:::raw_ptr<T>
+  void AddReplacement(const clang::FieldDecl& field_decl,
+                      const clang::SourceManager& source_manager,
                       const clang::SourceRange& replacement_range,
                       std::string replacement_text,
                       bool should_add_include = false) {
@@ -177,16 +325,15 @@ class OutputHelper : public clang::tooling::SourceFileCallbacks {
     if (file_path.empty())
       return;
 
-    std::replace(replacement_text.begin(), replacement_text.end(), '\n', '\0');
-    std::string replacement_directive = llvm::formatv(
-        "r:::{0}:::{1}:::{2}:::{3}", file_path, replacement.getOffset(),
-        replacement.getLength(), replacement_text);
-    edits_helper_.Add(replacement_directive);
+    std::string replacement_directive = EditWriter::FormatEdit(
+        "r", file_path, replacement.getOffset(), replacement.getLength(),
+        replacement_text);
+    AddEdit(field_decl, replacement_directive);
 
     if (should_add_include) {
-      std::string include_directive = llvm::formatv(
-          "include-user-header:::{0}:::-1:::-1:::{1}", file_path, kIncludePath);
-      edits_helper_.Add(include_directive);
+      std::string include_directive = EditWriter::FormatEdit(
+          "include-user-header", file_path, -1, -1, kIncludePath);
+      AddEdit(field_decl, include_directive);
     }
   }
 
@@ -194,31 +341,62 @@ class OutputHelper : public clang::tooling::SourceFileCallbacks {
                         llvm::StringRef filter_tag) {
     std::string qualified_name = field_decl.getQualifiedNameAsString();
     field_decl_filter_helper_.Add(qualified_name, filter_tag);
+    filter_count_++;
   }
 
- private:
-  // clang::tooling::SourceFileCallbacks override:
-  bool handleBeginSource(clang::CompilerInstance& compiler) override {
+  // Number of AddEdit / AddFilteredField calls so far (including duplicates).
+  size_t edit_count() const { return edit_count_; }
+  size_t filter_count() const { return filter_count_; }
+
+  bool BeginSourceFile(clang::CompilerInstance& compiler) {
     const clang::FrontendOptions& frontend_options = compiler.getFrontendOpts();
 
     assert((frontend_options.Inputs.size() == 1) &&
-           "run_tool.py should invoke the rewriter one file at a time");
+           "each compilation should have exactly one input file");
     const clang::FrontendInputFile& input_file = frontend_options.Inputs[0];
     assert(input_file.isFile() &&
-           "run_tool.py should invoke the rewriter on actual files");
+           "the rewriter should be invoked on actual files");
 
     current_language_ = input_file.getKind().getLanguage();
+    main_file_path_ = input_file.getFile().str();
 
-    return true;  // Report that |handleBeginSource| succeeded.
+    return true;  // Report that |BeginSourceFile| succeeded.
   }
 
-  // clang::tooling::SourceFileCallbacks override:
-  void handleEndSource() override {
+  void EndSourceFile(const clang::SourceManager& source_manager) {
     if (ShouldSuppressOutput())
       return;
 
-    edits_helper_.Emit();
-    field_decl_filter_helper_.Emit();
+    if (output_writer_->should_emit_dependencies())
+      AddDependencies(source_manager);
+
+    output_writer_->Write(edits_helper_, field_edits_helper_,
+                          field_decl_filter_helper_, dependencies_helper_);
+  }
+
+ private:
+  void AddEdit(const clang::FieldDecl& field_decl, llvm::StringRef directive) {
+    edit_count_++;
+    if (!output_writer_->is_single_pass()) {
+      edits_helper_.Add(directive);
+      return;
+    }
+
+    std::string qualified_name = field_decl.getQualifiedNameAsString();
+    field_edits_helper_.Add(
+        llvm::formatv("{0}:::{1}", qualified_name, directive).str());
+  }
+
+  // Adds a DEPENDENCIES line for each file read by the translation unit
+  // (including the main file itself), like:
+  //     /path/to/src/foo/bar.cc:::../../foo/bar.h
+  void AddDependencies(const clang::SourceManager& source_manager) {
+    for (auto it = source_manager.fileinfo_begin();
+         it != source_manager.fileinfo_end(); ++it) {
+      dependencies_helper_.Add(
+          llvm::formatv("{0}:::{1}", main_file_path_, it->first->getName())
+              .str());
+    }
   }
 
   bool ShouldSuppressOutput() {
@@ -250,9 +428,93 @@ class OutputHelper : public clang::tooling::SourceFileCallbacks {
     return true;
   }
 
+  OutputWriter* const output_writer_;
   OutputSectionHelper edits_helper_;
+  OutputSectionHelper field_edits_helper_;
   OutputSectionHelper field_decl_filter_helper_;
+  OutputSectionHelper dependencies_helper_;
+  std::string main_file_path_;
   clang::Language current_language_ = clang::Language::Unknown;
+  size_t edit_count_ = 0;
+  size_t filter_count_ = 0;
+};
+
+// Statistics of a single matcher (see --stats).
+struct MatcherStats {
+  uint64_t matches = 0;
+  uint64_t edits = 0;
+  uint64_t filters = 0;
+  llvm::TimeRecord time;
+};
+
+// Aggregates MatcherStats over all the translation units processed by this
+// process (possibly concurrently) and prints them once the rewriter is done.
+class StatsCollector {
+ public:
+  StatsCollector() = default;
+
+  StatsCollector(const StatsCollector&) = delete;
+  StatsCollector& operator=(const StatsCollector&) = delete;
+
+  // Adds the stats of a single translation unit.  |time_records| are the
+  // profiling records of MatchFinder, keyed by matcher names.
+  void Add(const llvm::StringMap<MatcherStats>& stats,
+           const llvm::StringMap<llvm::TimeRecord>& time_records) {
+    std::lock_guard<std::mutex> guard(lock_);
+    translation_unit_count_++;
+    for (const auto& entry : stats) {
+      MatcherStats& total = stats_[entry.getKey()];
+      total.matches += entry.getValue().matches;
+      total.edits += entry.getValue().edits;
+      total.filters += entry.getValue().filters;
+    }
+    for (const auto& entry : time_records)
+      stats_[entry.getKey()].time += entry.getValue();
+  }
+
+  // Prints the stats, starting with the most expensive matchers.
+  void Print(llvm::raw_ostream& out) {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::vector<const llvm::StringMapEntry<MatcherStats>*> sorted_entries;
+    MatcherStats total;
+    for (const auto& entry : stats_) {
+      sorted_entries.push_back(&entry);
+      total.matches += entry.getValue().matches;
+      total.edits += entry.getValue().edits;
+      total.filters += entry.getValue().filters;
+      total.time += entry.getValue().time;
+    }
+    std::sort(sorted_entries.begin(), sorted_entries.end(),
+              [](const auto* a, const auto* b) {
+                double a_time = a->getValue().time.getProcessTime();
+                double b_time = b->getValue().time.getProcessTime();
+                if (a_time != b_time)
+                  return a_time > b_time;
+                return a->getKey() < b->getKey();
+              });
+
+    out << "==== MATCHER STATS (" << translation_unit_count_
+        << " translation units) ====\n";
+    const char kRowFormat[] = "{0,-34} {1,10} {2,10} {3,10} {4,10} {5,10}\n";
+    const char kStatsRowFormat[] =
+        "{0,-34} {1,10} {2,10} {3,10} {4,10:f3} {5,10:f3}\n";
+    out << llvm::formatv(kRowFormat, "matcher", "matches", "edits", "filters",
+                         "cpu (s)", "wall (s)");
+    auto print_row = [&](llvm::StringRef name, const MatcherStats& stats) {
+      out << llvm::formatv(kStatsRowFormat, name, stats.matches, stats.edits,
+                           stats.filters, stats.time.getProcessTime(),
+                           stats.time.getWallTime());
+    };
+    for (const auto* entry : sorted_entries)
+      print_row(entry->getKey(), entry->getValue());
+    print_row("(total)", total);
+    out.flush();
+  }
+
+ private:
+  std::mutex lock_;
+  size_t translation_unit_count_ = 0;
+  llvm::StringMap<MatcherStats> stats_;
 };
 
 llvm::StringRef GetFilePath(const clang::SourceManager& source_manager,
@@ -292,11 +554,114 @@ AST_MATCHER(clang::FieldDecl, isInGeneratedLocation) {
   return file_path.startswith("gen/") || file_path.contains("/gen/");
 }
 
+// Matches strings against a set of substrings all at once (using the
+// Aho-Corasick algorithm), in time proportional to the length of the matched
+// string, independently of how many substrings are in the set.
+class SubstringSetMatcher {
+ public:
+  SubstringSetMatcher() : nodes_(1) {}
+
+  SubstringSetMatcher(const SubstringSetMatcher&) = delete;
+  SubstringSetMatcher& operator=(const SubstringSetMatcher&) = delete;
+
+  // Adds |substring| to the set.  Build() needs to be called after all the
+  // substrings have been added.
+  void Add(llvm::StringRef substring) {
+    if (substring.empty())
+      return;
+
+    unsigned node = kRootNode;
+    for (char c : substring) {
+      unsigned child = FindChild(node, c);
+      if (child == kRootNode) {
+        child = nodes_.size();
+        nodes_[node].children.emplace_back(c, child);
+        nodes_.emplace_back();
+      }
+      node = child;
+    }
+    nodes_[node].is_match = true;
+  }
+
+  // Computes the failure links of the trie built by Add(), in breadth-first
+  // order (so that the failure link of a node always points to an already
+  // processed node).
+  void Build() {
+    std::queue<unsigned> queue;
+    for (const auto& child : nodes_[kRootNode].children)
+      queue.push(child.second);
+
+    while (!queue.empty()) {
+      unsigned node = queue.front();
+      queue.pop();
+
+      for (const auto& child : nodes_[node].children) {
+        char c = child.first;
+        unsigned fallback = nodes_[node].failure;
+        unsigned failure = FindChild(fallback, c);
+        while (failure == kRootNode && fallback != kRootNode) {
+          fallback = nodes_[fallback].failure;
+          failure = FindChild(fallback, c);
+        }
+        nodes_[child.second].failure = failure;
+        if (nodes_[failure].is_match)
+          nodes_[child.second].is_match = true;
+        queue.push(child.second);
+      }
+    }
+  }
+
+  // Returns true if any of the substrings in the set is contained in |str|.
+  bool IsAnyContainedIn(llvm::StringRef str) const {
+    unsigned node = kRootNode;
+    for (char c : str) {
+      unsigned next = FindChild(node, c);
+      while (next == kRootNode && node != kRootNode) {
+        node = nodes_[node].failure;
+        next = FindChild(node, c);
+      }
+      node = next;
+      if (nodes_[node].is_match)
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  // The root node is never a child of another node, so its index is also used
+  // by FindChild to indicate that there is no child.
+  static constexpr unsigned kRootNode = 0;
+
+  struct Node {
+    // Most nodes have just a single child, so a plain vector is both more
+    // compact and faster to search than a map.
+    std::vector<std::pair<char, unsigned>> children;
+
+    // The node representing the longest proper suffix of this node's string
+    // that is also a prefix of one of the substrings in the set.
+    unsigned failure = kRootNode;
+
+    // Whether this node's string ends with one of the substrings in the set.
+    bool is_match = false;
+  };
+
+  unsigned FindChild(unsigned node, char c) const {
+    for (const auto& child : nodes_[node].children) {
+      if (child.first == c)
+        return child.second;
+    }
+    return kRootNode;
+  }
+
+  std::vector<Node> nodes_;
+};
+
 // Represents a filter file specified via cmdline.
 class FilterFile {
  public:
   explicit FilterFile(const llvm::cl::opt<std::string>& cmdline_param) {
     ParseInputFile(cmdline_param);
+    BuildSubstringMatchers();
   }
 
   FilterFile(const FilterFile&) = delete;
@@ -313,33 +678,24 @@ class FilterFile {
   // Only returns true if |string_to_match| both matches an inclusion filter and
   // is *not* matched by an exclusion filter.
   bool ContainsSubstringOf(llvm::StringRef string_to_match) const {
-    if (!inclusion_substring_regex_.hasValue()) {
-      std::vector<std::string> regex_escaped_inclusion_file_lines;
-      std::vector<std::string> regex_escaped_exclusion_file_lines;
-      regex_escaped_inclusion_file_lines.reserve(file_lines_.size());
-      for (const llvm::StringRef& file_line : file_lines_.keys()) {
-        if (file_line.startswith("!")) {
-          regex_escaped_exclusion_file_lines.push_back(
-              llvm::Regex::escape(file_line.substr(1)));
-        } else {
-          regex_escaped_inclusion_file_lines.push_back(
-              llvm::Regex::escape(file_line));
-        }
-      }
-      std::string inclusion_substring_regex_pattern =
-          llvm::join(regex_escaped_inclusion_file_lines.begin(),
-                     regex_escaped_inclusion_file_lines.end(), "|");
-      inclusion_substring_regex_.emplace(inclusion_substring_regex_pattern);
-      std::string exclusion_substring_regex_pattern =
-          llvm::join(regex_escaped_exclusion_file_lines.begin(),
-                     regex_escaped_exclusion_file_lines.end(), "|");
-      exclusion_substring_regex_.emplace(exclusion_substring_regex_pattern);
-    }
-    return inclusion_substring_regex_->match(string_to_match) &&
-           !exclusion_substring_regex_->match(string_to_match);
+    return inclusion_substrings_.IsAnyContainedIn(string_to_match) &&
+           !exclusion_substrings_.IsAnyContainedIn(string_to_match);
   }
 
  private:
+  // The matchers are built upfront (rather than lazily), so that a FilterFile
+  // can be safely shared by translation units processed on different threads.
+  void BuildSubstringMatchers() {
+    for (const llvm::StringRef& file_line : file_lines_.keys()) {
+      if (file_line.startswith("!"))
+        exclusion_substrings_.Add(file_line.substr(1));
+      else
+        inclusion_substrings_.Add(file_line);
+    }
+    inclusion_substrings_.Build();
+    exclusion_substrings_.Build();
+  }
+
   // Expected file format:
   // - '#' character starts a comment (which gets ignored).
   // - Blank or whitespace-only or comment-only lines are ignored.
@@ -386,29 +742,88 @@ class FilterFile {
   // |file_lines_| is partitioned based on whether the line starts with a !
   // (exclusion line) or not (inclusion line). Inclusion lines specify things to
   // be matched by the filter. The exclusion lines specify what to force exclude
-  // from the filter. Lazily-constructed regex that matches strings that contain
-  // any of the inclusion lines in |file_lines_|.
-  mutable llvm::Optional<llvm::Regex> inclusion_substring_regex_;
+  // from the filter. Matches strings that contain any of the inclusion lines in
+  // |file_lines_|.
+  SubstringSetMatcher inclusion_substrings_;
 
-  // Lazily-constructed regex that matches strings that contain any of the
-  // exclusion lines in |file_lines_|.
-  mutable llvm::Optional<llvm::Regex> exclusion_substring_regex_;
+  // Matches strings that contain any of the exclusion lines in |file_lines_|.
+  SubstringSetMatcher exclusion_substrings_;
+};
+
+// Memoizes, per FieldDecl, whether the qualified name of a field is listed in
+// a FilterFile.  Formatting the qualified name is the expensive part, and the
+// same (explicit) field is typically looked up many times.  FieldDecls are
+// specific to a translation unit, so each translation unit needs a separate
+// instance.
+class FieldFilterCache {
+ public:
+  explicit FieldFilterCache(const FilterFile& filter) : filter_(filter) {}
+
+  FieldFilterCache(const FieldFilterCache&) = delete;
+  FieldFilterCache& operator=(const FieldFilterCache&) = delete;
+
+  bool IsListed(const clang::FieldDecl& field_decl) {
+    auto it = verdicts_.find(&field_decl);
+    if (it != verdicts_.end())
+      return it->second;
+
+    bool verdict = filter_.ContainsLine(field_decl.getQualifiedNameAsString());
+    verdicts_.try_emplace(&field_decl, verdict);
+    return verdict;
+  }
+
+ private:
+  const FilterFile& filter_;
+  llvm::DenseMap<const clang::FieldDecl*, bool> verdicts_;
 };
 
 AST_MATCHER_P(clang::FieldDecl,
               isFieldDeclListedInFilterFile,
-              const FilterFile*,
+              FieldFilterCache*,
               Filter) {
-  return Filter->ContainsLine(Node.getQualifiedNameAsString());
+  return Filter->IsListed(Node);
 }
 
+// Memoizes, per FileID, whether the path of a file is matched by
+// FilterFile::ContainsSubstringOf.  All the fields declared in a given file
+// share the same verdict, so this avoids matching the same path over and over
+// again.  FileIDs are specific to a translation unit, so each translation unit
+// needs a separate instance.
+class PathFilterCache {
+ public:
+  explicit PathFilterCache(const FilterFile& filter) : filter_(filter) {}
+
+  PathFilterCache(const PathFilterCache&) = delete;
+  PathFilterCache& operator=(const PathFilterCache&) = delete;
+
+  bool IsInListedPath(const clang::SourceManager& source_manager,
+                      const clang::FieldDecl& field_decl) {
+    clang::SourceLocation loc = field_decl.getSourceRange().getBegin();
+    if (loc.isInvalid() || !loc.isFileID())
+      return filter_.ContainsSubstringOf(llvm::StringRef());
+
+    clang::FileID file_id = source_manager.getFileID(loc);
+    auto it = verdicts_.find(file_id);
+    if (it != verdicts_.end())
+      return it->second;
+
+    bool verdict =
+        filter_.ContainsSubstringOf(GetFilePath(source_manager, field_decl));
+    verdicts_.try_emplace(file_id, verdict);
+    return verdict;
+  }
+
+ private:
+  const FilterFile& filter_;
+  llvm::DenseMap<clang::FileID, bool> verdicts_;
+};
+
 AST_MATCHER_P(clang::FieldDecl,
               isInLocationListedInFilterFile,
-              const FilterFile*,
+              PathFilterCache*,
               Filter) {
-  llvm::StringRef file_path =
-      GetFilePath(Finder->getASTContext().getSourceManager(), Node);
-  return Filter->ContainsSubstringOf(file_path);
+  return Filter->IsInListedPath(Finder->getASTContext().getSourceManager(),
+                                Node);
 }
 
 AST_MATCHER(clang::Decl, isInExternCContext) {
@@ -517,38 +932,6 @@ const clang::FieldDecl* GetExplicitDecl(const clang::FieldDecl* field_decl) {
   return field_decl;
 }
 
-// Given:
-//   template <typename T>
-//   class MyTemplate {
-//     T field;  // This is an explicit field declaration.
-//   };
-//   void foo() {
-//     // This creates implicit template specialization for MyTemplate,
-//     // including an implicit |field| declaration.
-//     MyTemplate<int> v;
-//     v.field = 123;
-//   }
-// and
-//   innerMatcher that will match the explicit |T field| declaration (but not
-//   necessarily the implicit template declarations),
-// hasExplicitFieldDecl(innerMatcher) will match both explicit and implicit
-// field declarations.
-//
-// For example, |member_expr_matcher| below will match |v.field| in the example
-// above, even though the type of |v.field| is |int|, rather than |T| (matched
-// by substTemplateTypeParmType()):
-//   auto explicit_field_decl_matcher =
-//       fieldDecl(hasType(substTemplateTypeParmType()));
-//   auto member_expr_matcher = memberExpr(member(fieldDecl(
-//       hasExplicitFieldDecl(explicit_field_decl_matcher))))
-AST_MATCHER_P(clang::FieldDecl,
-              hasExplicitFieldDecl,
-              clang::ast_matchers::internal::Matcher<clang::FieldDecl>,
-              InnerMatcher) {
-  const clang::FieldDecl* explicit_field_decl = GetExplicitDecl(&Node);
-  return InnerMatcher.matches(*explicit_field_decl, Finder, Builder);
-}
-
 // If |original_param| declares a parameter in an implicit template
 // specialization of a function or method, then finds and returns the
 // corresponding ParmVarDecl from the template definition.  Otherwise, just
@@ -630,11 +1013,86 @@ const clang::ParmVarDecl* GetExplicitDecl(
   return pattern_func->getParamDecl(pattern_index);
 }
 
-AST_MATCHER_P(clang::ParmVarDecl,
-              hasExplicitParmVarDecl,
-              clang::ast_matchers::internal::Matcher<clang::ParmVarDecl>,
-              InnerMatcher) {
-  const clang::ParmVarDecl* explicit_param = GetExplicitDecl(&Node);
+// Memoizes GetExplicitDecl.  The affected-expression matchers ask about the
+// same (often implicitly instantiated) fields and parameters over and over
+// again.  Decls are specific to a translation unit, so each translation unit
+// needs a separate instance.
+class ExplicitDeclCache {
+ public:
+  ExplicitDeclCache() = default;
+
+  ExplicitDeclCache(const ExplicitDeclCache&) = delete;
+  ExplicitDeclCache& operator=(const ExplicitDeclCache&) = delete;
+
+  const clang::FieldDecl* Get(const clang::FieldDecl* field_decl) {
+    auto it = explicit_fields_.find(field_decl);
+    if (it != explicit_fields_.end())
+      return it->second;
+
+    const clang::FieldDecl* explicit_field_decl = GetExplicitDecl(field_decl);
+    explicit_fields_.try_emplace(field_decl, explicit_field_decl);
+    return explicit_field_decl;
+  }
+
+  // Like GetExplicitDecl, may return nullptr.
+  const clang::ParmVarDecl* Get(const clang::ParmVarDecl* param) {
+    auto it = explicit_params_.find(param);
+    if (it != explicit_params_.end())
+      return it->second;
+
+    const clang::ParmVarDecl* explicit_param = GetExplicitDecl(param);
+    explicit_params_.try_emplace(param, explicit_param);
+    return explicit_param;
+  }
+
+ private:
+  llvm::DenseMap<const clang::FieldDecl*, const clang::FieldDecl*>
+      explicit_fields_;
+  llvm::DenseMap<const clang::ParmVarDecl*, const clang::ParmVarDecl*>
+      explicit_params_;
+};
+
+// Given:
+//   template <typename T>
+//   class MyTemplate {
+//     T field;  // This is an explicit field declaration.
+//   };
+//   void foo() {
+//     // This creates implicit template specialization for MyTemplate,
+//     // including an implicit |field| declaration.
+//     MyTemplate<int> v;
+//     v.field = 123;
+//   }
+// and
+//   innerMatcher that will match the explicit |T field| declaration (but not
+//   necessarily the implicit template declarations),
+// hasExplicitFieldDecl(cache, innerMatcher) will match both explicit and
+// implicit field declarations.
+//
+// For example, |member_expr_matcher| below will match |v.field| in the example
+// above, even though the type of |v.field| is |int|, rather than |T| (matched
+// by substTemplateTypeParmType()):
+//   auto explicit_field_decl_matcher =
+//       fieldDecl(hasType(substTemplateTypeParmType()));
+//   auto member_expr_matcher = memberExpr(member(fieldDecl(
+//       hasExplicitFieldDecl(cache, explicit_field_decl_matcher))))
+AST_MATCHER_P2(clang::FieldDecl,
+               hasExplicitFieldDecl,
+               ExplicitDeclCache*,
+               Cache,
+               clang::ast_matchers::internal::Matcher<clang::FieldDecl>,
+               InnerMatcher) {
+  const clang::FieldDecl* explicit_field_decl = Cache->Get(&Node);
+  return InnerMatcher.matches(*explicit_field_decl, Finder, Builder);
+}
+
+AST_MATCHER_P2(clang::ParmVarDecl,
+               hasExplicitParmVarDecl,
+               ExplicitDeclCache*,
+               Cache,
+               clang::ast_matchers::internal::Matcher<clang::ParmVarDecl>,
+               InnerMatcher) {
+  const clang::ParmVarDecl* explicit_param = Cache->Get(&Node);
   if (!explicit_param) {
     // Rare, unimplemented case - fall back to returning "no match".
     return false;
@@ -643,53 +1101,126 @@ AST_MATCHER_P(clang::ParmVarDecl,
   return InnerMatcher.matches(*explicit_param, Finder, Builder);
 }
 
-// Returns |true| if and only if:
-// 1. |a| and |b| are in the same file (e.g. |false| is returned if any location
-//    is within macro scratch space or a similar location;  similarly |false| is
-//    returned if |a| and |b| are in different files).
-// 2. |a| and |b| overlap.
-bool IsOverlapping(const clang::SourceManager& source_manager,
-                   const clang::SourceRange& a,
-                   const clang::SourceRange& b) {
-  clang::FullSourceLoc a1(a.getBegin(), source_manager);
-  clang::FullSourceLoc a2(a.getEnd(), source_manager);
-  clang::FullSourceLoc b1(b.getBegin(), source_manager);
-  clang::FullSourceLoc b2(b.getEnd(), source_manager);
-
-  // Are all locations in a file?
-  if (!a1.isFileID() || !a2.isFileID() || !b1.isFileID() || !b2.isFileID())
-    return false;
+// Precomputed, per RecordDecl, source ranges of the decls within the record,
+// so that overlapsOtherDeclsWithinRecordDecl doesn't need to compare each
+// field against all the other decls (generated structs can have hundreds of
+// fields).  Decls are specific to a translation unit, so each translation unit
+// needs a separate instance.
+class RecordDeclRangesCache {
+ public:
+  RecordDeclRangesCache() = default;
+
+  RecordDeclRangesCache(const RecordDeclRangesCache&) = delete;
+  RecordDeclRangesCache& operator=(const RecordDeclRangesCache&) = delete;
+
+  // Returns |true| if and only if the source range of |field_decl| overlaps the
+  // source range of another decl within the parent RecordDecl.  Ranges only
+  // overlap if all their locations are in the same file (e.g. ranges within
+  // macro scratch space or a similar location never overlap).
+  bool OverlapsOtherDecls(const clang::SourceManager& source_manager,
+                          const clang::FieldDecl& field_decl) {
+    Range self;
+    if (!GetRange(source_manager, field_decl, &self))
+      return false;
+
+    const std::vector<Range>& ranges =
+        GetSortedRanges(source_manager, *field_decl.getParent());
+    auto is_before = [](const Range& a, const Range& b) {
+      return std::tie(a.file_id, a.begin) < std::tie(b.file_id, b.begin);
+    };
+    auto lower =
+        std::lower_bound(ranges.begin(), ranges.end(), self, is_before);
+    auto upper = std::upper_bound(lower, ranges.end(), self, is_before);
+
+    // Another decl starts at the same offset:
+    //    A: |============|
+    //    B: |=======|
+    if (std::distance(lower, upper) > 1)
+      return true;
+
+    // The next decl starts within |self|:
+    //    A: |============|
+    //    B:      |===============|
+    if (upper != ranges.end() && upper->file_id == self.file_id &&
+        upper->begin <= self.end) {
+      return true;
+    }
+
+    // One of the preceding decls ends within or after |self|:
+    //    B: |============|
+    //    A:      |===============|
+    // (|max_end| covers the preceding decls in the same file).
+    if (lower != ranges.begin()) {
+      const Range& previous = *std::prev(lower);
+      if (previous.file_id == self.file_id && previous.max_end >= self.begin)
+        return true;
+    }
 
-  // Are all locations in the same file?
-  if (a1.getFileID() != a2.getFileID() || a2.getFileID() != b1.getFileID() ||
-      b1.getFileID() != b2.getFileID()) {
     return false;
   }
 
-  // Check the 2 cases below:
-  // 1. A: |============|
-  //    B:      |===============|
-  //       a1   b1      a2      b2
-  // or
-  // 2. A: |====================|
-  //    B:      |=======|
-  //       a1   b1      b2      a2
-  bool b1_is_inside_a_range = a1.getFileOffset() <= b1.getFileOffset() &&
-                              b1.getFileOffset() <= a2.getFileOffset();
-
-  // Check the 2 cases below:
-  // 1. B: |============|
-  //    A:      |===============|
-  //       b1   a1      b2      a2
-  // or
-  // 2. B: |====================|
-  //    A:      |=======|
-  //       b1   a1      a2      b2
-  bool a1_is_inside_b_range = b1.getFileOffset() <= a1.getFileOffset() &&
-                              a1.getFileOffset() <= b2.getFileOffset();
-
-  return b1_is_inside_a_range || a1_is_inside_b_range;
-}
+ private:
+  struct Range {
+    clang::FileID file_id;
+    unsigned begin;
+    unsigned end;
+    // Maximum |end| of this and all the preceding ranges in the same file.
+    unsigned max_end;
+  };
+
+  // Returns false if |decl| doesn't have both ends in the same file.
+  static bool GetRange(const clang::SourceManager& source_manager,
+                       const clang::Decl& decl,
+                       Range* range) {
+    clang::SourceLocation begin = decl.getBeginLoc();
+    clang::SourceLocation end = decl.getEndLoc();
+    if (begin.isInvalid() || end.isInvalid() || !begin.isFileID() ||
+        !end.isFileID()) {
+      return false;
+    }
+
+    std::pair<clang::FileID, unsigned> decomposed_begin =
+        source_manager.getDecomposedLoc(begin);
+    std::pair<clang::FileID, unsigned> decomposed_end =
+        source_manager.getDecomposedLoc(end);
+    if (decomposed_begin.first != decomposed_end.first)
+      return false;
+
+    range->file_id = decomposed_begin.first;
+    range->begin = decomposed_begin.second;
+    range->end = decomposed_end.second;
+    range->max_end = range->end;
+    return true;
+  }
+
+  const std::vector<Range>& GetSortedRanges(
+      const clang::SourceManager& source_manager,
+      const clang::RecordDecl& record_decl) {
+    auto it = ranges_.find(&record_decl);
+    if (it != ranges_.end())
+      return it->second;
+
+    std::vector<Range> ranges;
+    for (const clang::Decl* decl : record_decl.decls()) {
+      Range range;
+      if (GetRange(source_manager, *decl, &range))
+        ranges.push_back(range);
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+      return std::tie(a.file_id, a.begin, a.end) <
+             std::tie(b.file_id, b.begin, b.end);
+    });
+    for (size_t i = 1; i < ranges.size(); i++) {
+      if (ranges[i].file_id == ranges[i - 1].file_id) {
+        ranges[i].max_end = std::max(ranges[i].max_end, ranges[i - 1].max_end);
+      }
+    }
+
+    return ranges_.try_emplace(&record_decl, std::move(ranges)).first->second;
+  }
+
+  llvm::DenseMap<const clang::RecordDecl*, std::vector<Range>> ranges_;
+};
 
 // Matcher for FieldDecl that has a SourceRange that overlaps other declarations
 // within the parent RecordDecl.
@@ -703,26 +1234,12 @@ bool IsOverlapping(const clang::SourceManager& source_manager,
 // - doesn't match |f|
 // - matches |f2| and |f3| (which overlap each other's location)
 // - matches |f4| (which overlaps the location of |S|)
-AST_MATCHER(clang::FieldDecl, overlapsOtherDeclsWithinRecordDecl) {
-  const clang::FieldDecl& self = Node;
-  const clang::SourceManager& source_manager =
-      Finder->getASTContext().getSourceManager();
-
-  const clang::RecordDecl* record_decl = self.getParent();
-  clang::SourceRange self_range(self.getBeginLoc(), self.getEndLoc());
-
-  auto is_overlapping_sibling = [&](const clang::Decl* other_decl) {
-    if (other_decl == &self)
-      return false;
-
-    clang::SourceRange other_range(other_decl->getBeginLoc(),
-                                   other_decl->getEndLoc());
-    return IsOverlapping(source_manager, self_range, other_range);
-  };
-  bool has_sibling_with_overlapping_location =
-      std::any_of(record_decl->decls_begin(), record_decl->decls_end(),
-                  is_overlapping_sibling);
-  return has_sibling_with_overlapping_location;
+AST_MATCHER_P(clang::FieldDecl,
+              overlapsOtherDeclsWithinRecordDecl,
+              RecordDeclRangesCache*,
+              Cache) {
+  return Cache->OverlapsOtherDecls(Finder->getASTContext().getSourceManager(),
+                                   Node);
 }
 
 // Matches clang::Type if
@@ -731,25 +1248,29 @@ AST_MATCHER(clang::FieldDecl, overlapsOtherDeclsWithinRecordDecl) {
 // or
 // 2) it represents an array or a RecordDecl that nests the case #1
 //    (this recurses to any depth).
-AST_MATCHER_P(clang::QualType,
-              typeWithEmbeddedFieldDecl,
-              clang::ast_matchers::internal::Matcher<clang::FieldDecl>,
-              InnerMatcher) {
+AST_MATCHER_P2(clang::QualType,
+               typeWithEmbeddedFieldDecl,
+               ExplicitDeclCache*,
+               Cache,
+               clang::ast_matchers::internal::Matcher<clang::FieldDecl>,
+               InnerMatcher) {
   const clang::Type* type =
       Node.getDesugaredType(Finder->getASTContext()).getTypePtrOrNull();
   if (!type)
     return false;
 
   if (const clang::CXXRecordDecl* record_decl = type->getAsCXXRecordDecl()) {
-    auto matcher = recordDecl(forEach(fieldDecl(hasExplicitFieldDecl(anyOf(
-        InnerMatcher, hasType(typeWithEmbeddedFieldDecl(InnerMatcher)))))));
+    auto matcher = recordDecl(forEach(fieldDecl(hasExplicitFieldDecl(
+        Cache,
+        anyOf(InnerMatcher,
+              hasType(typeWithEmbeddedFieldDecl(Cache, InnerMatcher)))))));
     return matcher.matches(*record_decl, Finder, Builder);
   }
 
   if (type->isArrayType()) {
     const clang::ArrayType* array_type =
         Finder->getASTContext().getAsArrayType(Node);
-    auto matcher = typeWithEmbeddedFieldDecl(InnerMatcher);
+    auto matcher = typeWithEmbeddedFieldDecl(Cache, InnerMatcher);
     return matcher.matches(array_type->getElementType(), Finder, Builder);
   }
 
@@ -867,8 +1388,8 @@ class FieldDeclRewriter : public MatchFinder::MatchCallback {
       replacement_text.insert(0, "mutable ");
 
     // Generate and print a replacement.
-    output_helper_->AddReplacement(source_manager, replacement_range,
-                                   replacement_text,
+    output_helper_->AddReplacement(*field_decl, source_manager,
+                                   replacement_range, replacement_text,
                                    true /* should_add_include */);
   }
 
@@ -925,7 +1446,14 @@ class AffectedExprRewriter : public MatchFinder::MatchCallback {
 
     clang::SourceRange replacement_range(insertion_loc, insertion_loc);
 
-    output_helper_->AddReplacement(source_manager, replacement_range, ".get()");
+    // For implicit template instantiations, |member_expr| refers to the
+    // instantiated field (e.g. |S<int>::ptr|), but the edit needs to be keyed
+    // by the explicit field (e.g. |S::ptr|), like the FIELD FILTERS are.
+    const clang::FieldDecl* field_decl =
+        result.Nodes.getNodeAs<clang::FieldDecl>("affectedFieldDecl");
+    assert(field_decl && "matcher should bind 'affectedFieldDecl'");
+    output_helper_->AddReplacement(*field_decl, source_manager,
+                                   replacement_range, ".get()");
   }
 
  private:
@@ -954,30 +1482,96 @@ class FilteredExprWriter : public MatchFinder::MatchCallback {
   llvm::StringRef filter_tag_;
 };
 
-}  // namespace
+// Forwards the matches of a single matcher to another callback, counting the
+// matches and the edits / filters they produce.  The matcher name is also
+// reported as the ID of the callback, which is how MatchFinder's profiling
+// records are keyed.
+class TrackedMatchCallback : public MatchFinder::MatchCallback {
+ public:
+  TrackedMatchCallback(llvm::StringRef matcher_name,
+                       MatchFinder::MatchCallback* callback,
+                       const OutputHelper* output_helper,
+                       MatcherStats* stats)
+      : matcher_name_(matcher_name),
+        callback_(callback),
+        output_helper_(output_helper),
+        stats_(stats) {}
+
+  TrackedMatchCallback(const TrackedMatchCallback&) = delete;
+  TrackedMatchCallback& operator=(const TrackedMatchCallback&) = delete;
+
+  // MatchFinder::MatchCallback overrides:
+  void run(const MatchFinder::MatchResult& result) override {
+    size_t edit_count = output_helper_->edit_count();
+    size_t filter_count = output_helper_->filter_count();
+    callback_->run(result);
+    stats_->matches++;
+    stats_->edits += output_helper_->edit_count() - edit_count;
+    stats_->filters += output_helper_->filter_count() - filter_count;
+  }
+  void onStartOfTranslationUnit() override {
+    callback_->onStartOfTranslationUnit();
+  }
+  void onEndOfTranslationUnit() override {
+    callback_->onEndOfTranslationUnit();
+  }
+  llvm::StringRef getID() const override { return matcher_name_; }
 
-int main(int argc, const char* argv[]) {
-  // TODO(dcheng): Clang tooling should do this itself.
-  // http://llvm.org/bugs/show_bug.cgi?id=21627
-  llvm::InitializeNativeTarget();
-  llvm::InitializeNativeTargetAsmParser();
-  llvm::cl::OptionCategory category(
-      "rewrite_raw_ptr_fields: changes |T* field_| to |raw_ptr<T> field_|.");
-  llvm::cl::opt<std::string> exclude_fields_param(
-      kExcludeFieldsParamName, llvm::cl::value_desc("filepath"),
-      llvm::cl::desc("file listing fields to be blocked (not rewritten)"));
-  llvm::cl::opt<std::string> exclude_paths_param(
-      kExcludePathsParamName, llvm::cl::value_desc("filepath"),
-      llvm::cl::desc("file listing paths to be blocked (not rewritten)"));
-  llvm::Expected<clang::tooling::CommonOptionsParser> options =
-      clang::tooling::CommonOptionsParser::create(argc, argv, category);
-  assert(static_cast<bool>(options));  // Should not return an error.
-  clang::tooling::ClangTool tool(options->getCompilations(),
-                                 options->getSourcePathList());
+ private:
+  llvm::StringRef matcher_name_;
+  MatchFinder::MatchCallback* const callback_;
+  const OutputHelper* const output_helper_;
+  MatcherStats* const stats_;
+};
+
+// Owns the match callbacks registered with a MatchFinder, and the stats of the
+// matchers they were registered for.
+class MatchCallbacks {
+ public:
+  explicit MatchCallbacks(const OutputHelper* output_helper)
+      : output_helper_(output_helper) {}
+
+  MatchCallbacks(const MatchCallbacks&) = delete;
+  MatchCallbacks& operator=(const MatchCallbacks&) = delete;
 
-  MatchFinder match_finder;
-  OutputHelper output_helper;
+  template <typename TCallback, typename... TArgs>
+  TCallback* Add(TArgs&&... args) {
+    auto callback = std::make_unique<TCallback>(std::forward<TArgs>(args)...);
+    TCallback* result = callback.get();
+    callbacks_.push_back(std::move(callback));
+    return result;
+  }
 
+  // Returns the callback that should be registered with the MatchFinder for
+  // the matcher named |matcher_name| (each matcher needs a distinct name).
+  // The returned callback forwards matches to |callback|.
+  MatchFinder::MatchCallback* Track(llvm::StringRef matcher_name,
+                                    MatchFinder::MatchCallback* callback) {
+    auto it = stats_.try_emplace(matcher_name);
+    assert(it.second && "matcher names should be unique");
+    return Add<TrackedMatchCallback>(it.first->getKey(), callback,
+                                     output_helper_,
+                                     &it.first->getValue());
+  }
+
+  const llvm::StringMap<MatcherStats>& stats() const { return stats_; }
+
+ private:
+  const OutputHelper* const output_helper_;
+  std::vector<std::unique_ptr<MatchFinder::MatchCallback>> callbacks_;
+  llvm::StringMap<MatcherStats> stats_;
+};
+
+// Registers all the matchers of the rewriter with |match_finder|.  The match
+// callbacks are owned by |callbacks| (which also tracks the stats of each
+// matcher) and report to |output_helper|.
+void AddMatchers(FieldFilterCache* fields_to_exclude,
+                 PathFilterCache* paths_to_exclude,
+                 ExplicitDeclCache* explicit_decls,
+                 RecordDeclRangesCache* record_decl_ranges,
+                 OutputHelper* output_helper,
+                 MatchCallbacks* callbacks,
+                 MatchFinder* match_finder) {
   // Supported pointer types =========
   // Given
   //   struct MyStrict {
@@ -1020,19 +1614,18 @@ int main(int argc, const char* argv[]) {
   //   matched by --exclude-paths cmdline param
   // - "implicit" fields (i.e. field decls that are not explicitly present in
   //   the source code)
-  FilterFile fields_to_exclude(exclude_fields_param);
-  FilterFile paths_to_exclude(exclude_paths_param);
   auto field_decl_matcher =
       fieldDecl(
           allOf(hasType(supported_pointer_types_matcher),
                 unless(anyOf(isExpansionInSystemHeader(), isInExternCContext(),
                              isInThirdPartyLocation(), isInGeneratedLocation(),
-                             isInLocationListedInFilterFile(&paths_to_exclude),
-                             isFieldDeclListedInFilterFile(&fields_to_exclude),
+                             isInLocationListedInFilterFile(paths_to_exclude),
+                             isFieldDeclListedInFilterFile(fields_to_exclude),
                              implicit_field_decl_matcher))))
           .bind("affectedFieldDecl");
-  FieldDeclRewriter field_decl_rewriter(&output_helper);
-  match_finder.addMatcher(field_decl_matcher, &field_decl_rewriter);
+  auto* field_decl_rewriter = callbacks->Add<FieldDeclRewriter>(output_helper);
+  match_finder->addMatcher(field_decl_matcher,
+                           callbacks->Track("field-decl", field_decl_rewriter));
 
   // Matches expressions that used to return a value of type |SomeClass*|
   // but after the rewrite return an instance of |raw_ptr<SomeClass>|.
@@ -1044,7 +1637,8 @@ int main(int argc, const char* argv[]) {
   //   additional work and should cause related fields to be emitted as
   //   candidates for the --field-filter-file parameter.
   auto affected_member_expr_matcher =
-      memberExpr(member(fieldDecl(hasExplicitFieldDecl(field_decl_matcher))))
+      memberExpr(member(fieldDecl(
+                     hasExplicitFieldDecl(explicit_decls, field_decl_matcher))))
           .bind("affectedMemberExpr");
   auto affected_expr_matcher = ignoringImplicit(affected_member_expr_matcher);
 
@@ -1062,9 +1656,11 @@ int main(int argc, const char* argv[]) {
       affected_expr_matcher,
       hasParent(expr(anyOf(callExpr(callee(functionDecl(isVariadic()))),
                            cxxConstCastExpr(), cxxReinterpretCastExpr())))));
-  AffectedExprRewriter affected_expr_rewriter(&output_helper);
-  match_finder.addMatcher(affected_expr_that_needs_fixing_matcher,
-                          &affected_expr_rewriter);
+  auto* affected_expr_rewriter =
+      callbacks->Add<AffectedExprRewriter>(output_helper);
+  match_finder->addMatcher(affected_expr_that_needs_fixing_matcher,
+                           callbacks->Track("affected-expr-needs-fixing",
+                                            affected_expr_rewriter));
 
   // Affected ternary operator args =========
   // Given
@@ -1077,8 +1673,9 @@ int main(int argc, const char* argv[]) {
   auto affected_ternary_operator_arg_matcher =
       conditionalOperator(eachOf(hasTrueExpression(affected_expr_matcher),
                                  hasFalseExpression(affected_expr_matcher)));
-  match_finder.addMatcher(affected_ternary_operator_arg_matcher,
-                          &affected_expr_rewriter);
+  match_finder->addMatcher(affected_ternary_operator_arg_matcher,
+                           callbacks->Track("ternary-operator-arg",
+                                            affected_expr_rewriter));
 
   // Affected string binary operator =========
   // Given
@@ -1097,8 +1694,9 @@ int main(int argc, const char* argv[]) {
       hasAnyOverloadedOperatorName("+", "==", "!=", "<", "<=", ">", ">="),
       hasAnyArgument(std_string_expr_matcher),
       forEachArgumentWithParam(affected_expr_matcher, parmVarDecl()));
-  match_finder.addMatcher(affected_string_binary_operator_arg_matcher,
-                          &affected_expr_rewriter);
+  match_finder->addMatcher(affected_string_binary_operator_arg_matcher,
+                           callbacks->Track("string-binary-operator-arg",
+                                            affected_expr_rewriter));
 
   // Calls to templated functions =========
   // Given
@@ -1115,14 +1713,16 @@ int main(int argc, const char* argv[]) {
       affected_expr_matcher, parmVarDecl(hasType(qualType(allOf(
                                  findAll(qualType(substTemplateTypeParmType())),
                                  unless(referenceType()))))));
-  match_finder.addMatcher(callExpr(templated_function_arg_matcher),
-                          &affected_expr_rewriter);
+  match_finder->addMatcher(callExpr(templated_function_arg_matcher),
+                           callbacks->Track("templated-function-call-arg",
+                                            affected_expr_rewriter));
   // TODO(lukasza): It is unclear why |traverse| below is needed.  Maybe it can
   // be removed if https://bugs.llvm.org/show_bug.cgi?id=46287 is fixed.
-  match_finder.addMatcher(
+  match_finder->addMatcher(
       traverse(clang::TraversalKind::TK_AsIs,
                cxxConstructExpr(templated_function_arg_matcher)),
-      &affected_expr_rewriter);
+      callbacks->Track("templated-function-construct-arg",
+                       affected_expr_rewriter));
 
   // Calls to constructors via an implicit cast =========
   // Given
@@ -1141,7 +1741,9 @@ int main(int argc, const char* argv[]) {
       hasDeclaration(
           cxxConstructorDecl(allOf(parameterCountIs(1), unless(isExplicit())))),
       forEachArgumentWithParam(affected_expr_matcher, parmVarDecl())));
-  match_finder.addMatcher(implicit_ctor_expr_matcher, &affected_expr_rewriter);
+  match_finder->addMatcher(implicit_ctor_expr_matcher,
+                           callbacks->Track("implicit-ctor-arg",
+                                            affected_expr_rewriter));
 
   // |auto| type declarations =========
   // Given
@@ -1157,7 +1759,9 @@ int main(int argc, const char* argv[]) {
                     hasInitializer(anyOf(
                         affected_expr_matcher,
                         initListExpr(hasInit(0, affected_expr_matcher))))))));
-  match_finder.addMatcher(auto_var_decl_matcher, &affected_expr_rewriter);
+  match_finder->addMatcher(auto_var_decl_matcher,
+                           callbacks->Track("auto-var-decl",
+                                            affected_expr_rewriter));
 
   // address-of(affected-expr) =========
   // Given
@@ -1168,9 +1772,11 @@ int main(int argc, const char* argv[]) {
   // See also the testcases in tests/gen-in-out-arg-test.cc.
   auto affected_addr_of_expr_matcher = expr(allOf(
       affected_expr_matcher, hasParent(unaryOperator(hasOperatorName("&")))));
-  FilteredExprWriter filtered_addr_of_expr_writer(&output_helper, "addr-of");
-  match_finder.addMatcher(affected_addr_of_expr_matcher,
-                          &filtered_addr_of_expr_writer);
+  auto* filtered_addr_of_expr_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "addr-of");
+  match_finder->addMatcher(affected_addr_of_expr_matcher,
+                           callbacks->Track("addr-of",
+                                            filtered_addr_of_expr_writer));
 
   // in-out reference arg =========
   // Given
@@ -1188,22 +1794,27 @@ int main(int argc, const char* argv[]) {
   //
   // See also the testcases in tests/gen-in-out-arg-test.cc.
   auto affected_in_out_ref_arg_matcher = callExpr(forEachArgumentWithParam(
-      affected_expr_matcher, hasExplicitParmVarDecl(hasType(qualType(
-                                 allOf(referenceType(pointee(pointerType())),
-                                       unless(rValueReferenceType())))))));
-  FilteredExprWriter filtered_in_out_ref_arg_writer(&output_helper,
-                                                    "in-out-param-ref");
-  match_finder.addMatcher(affected_in_out_ref_arg_matcher,
-                          &filtered_in_out_ref_arg_writer);
+      affected_expr_matcher,
+      hasExplicitParmVarDecl(
+          explicit_decls,
+          hasType(qualType(allOf(referenceType(pointee(pointerType())),
+                                 unless(rValueReferenceType())))))));
+  auto* filtered_in_out_ref_arg_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "in-out-param-ref");
+  match_finder->addMatcher(affected_in_out_ref_arg_matcher,
+                           callbacks->Track("in-out-param-ref",
+                                            filtered_in_out_ref_arg_writer));
 
   // See the doc comment for the overlapsOtherDeclsWithinRecordDecl matcher
   // and the testcases in tests/gen-overlaps-test.cc.
   auto overlapping_field_decl_matcher = fieldDecl(
-      allOf(field_decl_matcher, overlapsOtherDeclsWithinRecordDecl()));
-  FilteredExprWriter overlapping_field_decl_writer(&output_helper,
-                                                   "overlapping");
-  match_finder.addMatcher(overlapping_field_decl_matcher,
-                          &overlapping_field_decl_writer);
+      allOf(field_decl_matcher,
+            overlapsOtherDeclsWithinRecordDecl(record_decl_ranges)));
+  auto* overlapping_field_decl_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "overlapping");
+  match_finder->addMatcher(overlapping_field_decl_matcher,
+                           callbacks->Track("overlapping",
+                                            overlapping_field_decl_writer));
 
   // Matches fields initialized with a non-nullptr value in a constexpr
   // constructor.  See also the testcase in tests/gen-constexpr-test.cc.
@@ -1213,10 +1824,13 @@ int main(int argc, const char* argv[]) {
       allOf(isConstexpr(), forEachConstructorInitializer(allOf(
                                forField(field_decl_matcher),
                                withInitializer(non_nullptr_expr_matcher)))));
-  FilteredExprWriter constexpr_ctor_field_initializer_writer(
-      &output_helper, "constexpr-ctor-field-initializer");
-  match_finder.addMatcher(constexpr_ctor_field_initializer_matcher,
-                          &constexpr_ctor_field_initializer_writer);
+  auto* constexpr_ctor_field_initializer_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper,
+                                         "constexpr-ctor-field-initializer");
+  match_finder->addMatcher(
+      constexpr_ctor_field_initializer_matcher,
+      callbacks->Track("constexpr-ctor-field-initializer",
+                       constexpr_ctor_field_initializer_writer));
 
   // Matches constexpr initializer list expressions that initialize a rewritable
   // field with a non-nullptr value.  For more details and rationale see the
@@ -1225,18 +1839,21 @@ int main(int argc, const char* argv[]) {
       allOf(isConstexpr(),
             hasInitializer(findAll(initListExpr(forEachInitExprWithFieldDecl(
                 non_nullptr_expr_matcher,
-                hasExplicitFieldDecl(field_decl_matcher)))))));
-  FilteredExprWriter constexpr_var_initializer_writer(
-      &output_helper, "constexpr-var-initializer");
-  match_finder.addMatcher(constexpr_var_initializer_matcher,
-                          &constexpr_var_initializer_writer);
+                hasExplicitFieldDecl(explicit_decls, field_decl_matcher)))))));
+  auto* constexpr_var_initializer_writer = callbacks->Add<FilteredExprWriter>(
+      output_helper, "constexpr-var-initializer");
+  match_finder->addMatcher(constexpr_var_initializer_matcher,
+                           callbacks->Track("constexpr-var-initializer",
+                                            constexpr_var_initializer_writer));
 
   // See the doc comment for the isInMacroLocation matcher
   // and the testcases in tests/gen-macro-test.cc.
   auto macro_field_decl_matcher =
       fieldDecl(allOf(field_decl_matcher, isInMacroLocation()));
-  FilteredExprWriter macro_field_decl_writer(&output_helper, "macro");
-  match_finder.addMatcher(macro_field_decl_matcher, &macro_field_decl_writer);
+  auto* macro_field_decl_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "macro");
+  match_finder->addMatcher(macro_field_decl_matcher,
+                           callbacks->Track("macro", macro_field_decl_writer));
 
   // See the doc comment for the anyCharType matcher
   // and the testcases in tests/gen-char-test.cc.
@@ -1244,16 +1861,22 @@ int main(int argc, const char* argv[]) {
       field_decl_matcher,
       hasType(pointerType(pointee(qualType(allOf(
           isConstQualified(), hasUnqualifiedDesugaredType(anyCharType()))))))));
-  FilteredExprWriter char_ptr_field_decl_writer(&output_helper, "const-char");
-  match_finder.addMatcher(char_ptr_field_decl_matcher,
-                          &char_ptr_field_decl_writer);
+  auto* char_ptr_field_decl_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "const-char");
+  match_finder->addMatcher(char_ptr_field_decl_matcher,
+                           callbacks->Track("const-char",
+                                            char_ptr_field_decl_writer));
 
   // See the testcases in tests/gen-global-destructor-test.cc.
   auto global_destructor_matcher =
       varDecl(allOf(hasGlobalStorage(),
-                    hasType(typeWithEmbeddedFieldDecl(field_decl_matcher))));
-  FilteredExprWriter global_destructor_writer(&output_helper, "global-scope");
-  match_finder.addMatcher(global_destructor_matcher, &global_destructor_writer);
+                    hasType(typeWithEmbeddedFieldDecl(explicit_decls,
+                                                      field_decl_matcher))));
+  auto* global_destructor_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "global-scope");
+  match_finder->addMatcher(global_destructor_matcher,
+                           callbacks->Track("global-scope",
+                                            global_destructor_writer));
 
   // Matches fields in unions (both directly rewritable fields as well as union
   // fields that embed a struct that contains a rewritable field).  See also the
@@ -1261,9 +1884,12 @@ int main(int argc, const char* argv[]) {
   auto union_field_decl_matcher = recordDecl(allOf(
       isUnion(), forEach(fieldDecl(anyOf(field_decl_matcher,
                                          hasType(typeWithEmbeddedFieldDecl(
+                                             explicit_decls,
                                              field_decl_matcher)))))));
-  FilteredExprWriter union_field_decl_writer(&output_helper, "union");
-  match_finder.addMatcher(union_field_decl_matcher, &union_field_decl_writer);
+  auto* union_field_decl_writer =
+      callbacks->Add<FilteredExprWriter>(output_helper, "union");
+  match_finder->addMatcher(union_field_decl_matcher,
+                           callbacks->Track("union", union_field_decl_writer));
 
   // Matches rewritable fields of struct `SomeStruct` if that struct happens to
   // be a destination type of a `reinterpret_cast<SomeStruct*>` cast and is a
@@ -1273,17 +1899,210 @@ int main(int argc, const char* argv[]) {
       cxxReinterpretCastExpr(hasDestinationType(pointerType(pointee(
           hasUnqualifiedDesugaredType(recordType(hasDeclaration(cxxRecordDecl(
               allOf(forEach(field_decl_matcher), isTrivial())))))))));
-  FilteredExprWriter reinterpret_cast_struct_writer(
-      &output_helper, "reinterpret-cast-trivial-type");
-  match_finder.addMatcher(reinterpret_cast_struct_matcher,
-                          &reinterpret_cast_struct_writer);
+  auto* reinterpret_cast_struct_writer = callbacks->Add<FilteredExprWriter>(
+      output_helper, "reinterpret-cast-trivial-type");
+  match_finder->addMatcher(reinterpret_cast_struct_matcher,
+                           callbacks->Track("reinterpret-cast-trivial-type",
+                                            reinterpret_cast_struct_writer));
+}
+
+// Restricts the AST traversal (and therefore AST matching) to the top-level
+// declarations that can contain rewritable fields or expressions affected by
+// the rewrite.  Declarations located in system headers are skipped - they make
+// up most of a typical translation unit, but their fields are never rewritten
+// and they don't use Chromium fields.
+//
+// Note that declarations in third-party code, in generated files and in paths
+// matched by --exclude-paths are still traversed: their own fields are not
+// rewritten, but they may use (and therefore need to be checked against)
+// fields declared elsewhere.
+class TraversalScopeConsumer : public clang::ASTConsumer {
+ public:
+  explicit TraversalScopeConsumer(std::unique_ptr<clang::ASTConsumer> consumer)
+      : consumer_(std::move(consumer)) {}
+
+  TraversalScopeConsumer(const TraversalScopeConsumer&) = delete;
+  TraversalScopeConsumer& operator=(const TraversalScopeConsumer&) = delete;
+
+  // clang::ASTConsumer override:
+  void HandleTranslationUnit(clang::ASTContext& context) override {
+    const clang::SourceManager& source_manager = context.getSourceManager();
+    std::vector<clang::Decl*> traversal_scope;
+    for (clang::Decl* decl : context.getTranslationUnitDecl()->decls()) {
+      if (ShouldTraverse(source_manager, *decl))
+        traversal_scope.push_back(decl);
+    }
+    context.setTraversalScope(traversal_scope);
+
+    consumer_->HandleTranslationUnit(context);
+  }
+
+ private:
+  bool ShouldTraverse(const clang::SourceManager& source_manager,
+                      const clang::Decl& decl) {
+    clang::SourceLocation loc =
+        source_manager.getExpansionLoc(decl.getLocation());
+    if (loc.isInvalid())
+      return true;
+
+    // All the top-level declarations from a given file share the verdict.
+    clang::FileID file_id = source_manager.getFileID(loc);
+    auto it = verdicts_.find(file_id);
+    if (it != verdicts_.end())
+      return it->second;
+
+    bool verdict = !source_manager.isInSystemHeader(loc);
+    verdicts_.try_emplace(file_id, verdict);
+    return verdict;
+  }
+
+  std::unique_ptr<clang::ASTConsumer> consumer_;
+  llvm::DenseMap<clang::FileID, bool> verdicts_;
+};
+
+// Runs the rewriter over a single translation unit.  Each action has its own
+// MatchFinder and output state, so that separate actions can process
+// different translation units in parallel.
+class RewriterAction : public clang::ASTFrontendAction {
+ public:
+  // |stats_collector| may be null (if --stats wasn't passed).
+  RewriterAction(const FilterFile& fields_to_exclude,
+                 const FilterFile& paths_to_exclude,
+                 OutputWriter* output_writer,
+                 StatsCollector* stats_collector)
+      : output_helper_(output_writer),
+        fields_to_exclude_(fields_to_exclude),
+        paths_to_exclude_(paths_to_exclude),
+        callbacks_(&output_helper_),
+        stats_collector_(stats_collector),
+        match_finder_(GetMatchFinderOptions(
+            stats_collector ? &time_records_ : nullptr)) {
+    AddMatchers(&fields_to_exclude_, &paths_to_exclude_, &explicit_decls_,
+                &record_decl_ranges_, &output_helper_, &callbacks_,
+                &match_finder_);
+  }
+
+  RewriterAction(const RewriterAction&) = delete;
+  RewriterAction& operator=(const RewriterAction&) = delete;
+
+  // clang::ASTFrontendAction overrides:
+  std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+      clang::CompilerInstance& compiler,
+      llvm::StringRef in_file) override {
+    return std::make_unique<TraversalScopeConsumer>(
+        match_finder_.newASTConsumer());
+  }
+  bool BeginSourceFileAction(clang::CompilerInstance& compiler) override {
+    return output_helper_.BeginSourceFile(compiler);
+  }
+  void EndSourceFileAction() override {
+    output_helper_.EndSourceFile(getCompilerInstance().getSourceManager());
+    if (stats_collector_)
+      stats_collector_->Add(callbacks_.stats(), time_records_);
+  }
+
+ private:
+  // Enables MatchFinder's profiling if |time_records| is not null.
+  static MatchFinder::MatchFinderOptions GetMatchFinderOptions(
+      llvm::StringMap<llvm::TimeRecord>* time_records) {
+    MatchFinder::MatchFinderOptions options;
+    if (time_records)
+      options.CheckProfiling.emplace(*time_records);
+    return options;
+  }
+
+  OutputHelper output_helper_;
+  FieldFilterCache fields_to_exclude_;
+  PathFilterCache paths_to_exclude_;
+  ExplicitDeclCache explicit_decls_;
+  RecordDeclRangesCache record_decl_ranges_;
+  MatchCallbacks callbacks_;
+  StatsCollector* const stats_collector_;
+  // Filled in by |match_finder_| once the translation unit has been matched.
+  llvm::StringMap<llvm::TimeRecord> time_records_;
+  MatchFinder match_finder_;
+};
+
+class RewriterActionFactory : public clang::tooling::FrontendActionFactory {
+ public:
+  RewriterActionFactory(const FilterFile& fields_to_exclude,
+                        const FilterFile& paths_to_exclude,
+                        OutputWriter* output_writer,
+                        StatsCollector* stats_collector)
+      : fields_to_exclude_(fields_to_exclude),
+        paths_to_exclude_(paths_to_exclude),
+        output_writer_(output_writer),
+        stats_collector_(stats_collector) {}
+
+  RewriterActionFactory(const RewriterActionFactory&) = delete;
+  RewriterActionFactory& operator=(const RewriterActionFactory&) = delete;
+
+  // clang::tooling::FrontendActionFactory override:
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return std::make_unique<RewriterAction>(
+        fields_to_exclude_, paths_to_exclude_, output_writer_,
+        stats_collector_);
+  }
+
+ private:
+  const FilterFile& fields_to_exclude_;
+  const FilterFile& paths_to_exclude_;
+  OutputWriter* const output_writer_;
+  StatsCollector* const stats_collector_;
+};
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  // TODO(dcheng): Clang tooling should do this itself.
+  // http://llvm.org/bugs/show_bug.cgi?id=21627
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmParser();
+  llvm::cl::OptionCategory category(
+      "rewrite_raw_ptr_fields: changes |T* field_| to |raw_ptr<T> field_|.");
+  llvm::cl::opt<std::string> exclude_fields_param(
+      kExcludeFieldsParamName, llvm::cl::value_desc("filepath"),
+      llvm::cl::desc("file listing fields to be blocked (not rewritten)"));
+  llvm::cl::opt<std::string> exclude_paths_param(
+      kExcludePathsParamName, llvm::cl::value_desc("filepath"),
+      llvm::cl::desc("file listing paths to be blocked (not rewritten)"));
+  llvm::cl::opt<bool> single_pass_param(
+      kSinglePassParamName, llvm::cl::init(false),
+      llvm::cl::desc("emit edits keyed by field names, so that field filters "
+                     "can be applied by merge_single_pass_output.py"));
+  llvm::cl::opt<bool> emit_dependencies_param(
+      kEmitDependenciesParamName, llvm::cl::init(false),
+      llvm::cl::desc("emit the files read by each translation unit, so that "
+                     "incremental.py can later rerun only the affected "
+                     "translation units"));
+  llvm::cl::opt<bool> stats_param(
+      kStatsParamName, llvm::cl::init(false),
+      llvm::cl::desc("print (to stderr) the number of matches, edits and "
+                     "filters, and the time spent in each matcher"));
+  llvm::Expected<std::unique_ptr<clang::tooling::ToolExecutor>> executor =
+      clang::tooling::createExecutorFromCommandLineArgs(argc, argv, category);
+  if (!executor) {
+    llvm::errs() << llvm::toString(executor.takeError()) << "\n";
+    return 1;
+  }
+
+  FilterFile fields_to_exclude(exclude_fields_param);
+  FilterFile paths_to_exclude(exclude_paths_param);
+  OutputWriter output_writer(single_pass_param, emit_dependencies_param);
+  StatsCollector stats_collector;
 
   // Prepare and run the tool.
-  std::unique_ptr<clang::tooling::FrontendActionFactory> factory =
-      clang::tooling::newFrontendActionFactory(&match_finder, &output_helper);
-  int result = tool.run(factory.get());
-  if (result != 0)
-    return result;
+  llvm::Error error = (*executor)->execute(
+      std::make_unique<RewriterActionFactory>(
+          fields_to_exclude, paths_to_exclude, &output_writer,
+          stats_param ? &stats_collector : nullptr));
+  if (error) {
+    llvm::errs() << llvm::toString(std::move(error)) << "\n";
+    return 1;
+  }
+
+  if (stats_param)
+    stats_collector.Print(llvm::errs());
 
   return 0;
 }
@@ -0,0 +1,214 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Reruns rewrite_raw_ptr_fields only over translation units affected by
+changes since a previous run.
+
+When run with --emit-dependencies, the rewriter emits the files read by each
+translation unit (including the translation unit's main file):
+    ==== BEGIN DEPENDENCIES ====
+    /path/to/src/foo/bar.cc:::../../foo/bar.h
+    ==== END DEPENDENCIES ====
+The output of such a run (in the text --edits-format) serves as the dependency
+index for this script, which supports two commands:
+
+affected-tus: prints the translation units that read any of the changed files
+(plus changed source files that are not in the index yet, e.g. new files).
+These are the only translation units that need to be processed again.
+
+merge: reads the output of rerunning the rewriter (again with
+--emit-dependencies) over the affected translation units from stdin and prints
+it merged with the previous output.  Edits of the changed files are taken only
+from the new output (the previous edits have stale offsets).  Edits of other,
+untouched files are reused from the previous output.  Field filters are
+combined.  The merged output can be used as the dependency index of the next
+incremental run.
+
+Example usage (e.g. after a rebase):
+    $ git diff --name-only <old base> > ~/scratch/changed-files.txt
+    $ incremental.py affected-tus -p out/dir \\
+          --previous-output=~/scratch/rewriter.out \\
+          --changed-files=~/scratch/changed-files.txt \\
+          > ~/scratch/affected-tus.txt
+    $ run_tool.py --tool rewrite_raw_ptr_fields -p out/dir \\
+          --tool-arg=--emit-dependencies ... \\
+          $(cat ~/scratch/affected-tus.txt) \\
+        | incremental.py merge -p out/dir \\
+              --previous-output=~/scratch/rewriter.out \\
+              --changed-files=~/scratch/changed-files.txt \\
+        > ~/scratch/rewriter.new.out
+
+Note that edits of untouched files are reused even if the affected translation
+units newly filter out the field they belong to.  With --single-pass this is
+handled by merge_single_pass_output.py, since FIELD EDITS are keyed by field
+names.  Otherwise, the filters should be fed back via --exclude-fields as usual.
+"""
+
+import argparse
+import collections
+import os
+import sys
+
+EDITS_SECTION = 'EDITS'
+FIELD_EDITS_SECTION = 'FIELD EDITS'
+DEPENDENCIES_SECTION = 'DEPENDENCIES'
+
+# The order in which the sections of the merged output are printed.  Other
+# sections (e.g. FIELD FILTERS) are printed afterwards.
+SECTION_ORDER = [EDITS_SECTION, FIELD_EDITS_SECTION, DEPENDENCIES_SECTION]
+
+# Index of the file path among the ':::'-separated parts of an edit line.
+EDIT_PATH_INDEX = {EDITS_SECTION: 1, FIELD_EDITS_SECTION: 2}
+
+SOURCE_EXTENSIONS = ('.c', '.cc', '.cpp', '.cxx', '.m', '.mm')
+
+
+class InputError(Exception):
+  pass
+
+
+def _ReadSections(lines):
+  """Returns a map from section names to the lists of lines in the sections."""
+  sections = collections.defaultdict(list)
+  current_section = None
+  for line in lines:
+    line = line.rstrip('\n\r')
+    if line.startswith('==== BEGIN ') and line.endswith(' ===='):
+      current_section = line[len('==== BEGIN '):-len(' ====')]
+      if current_section == 'BINARY EDITS':
+        raise InputError('Binary edits are not supported; please run the '
+                         'rewriter with --edits-format=text')
+      continue
+    if line.startswith('==== END ') and line.endswith(' ===='):
+      current_section = None
+      continue
+    if current_section is not None:
+      sections[current_section].append(line)
+  return sections
+
+
+def _ReadSectionsFromFile(path):
+  with open(os.path.expanduser(path)) as f:
+    return _ReadSections(f)
+
+
+def _ReadChangedFiles(path):
+  """Returns the set of real paths of the files listed in |path|."""
+  with open(os.path.expanduser(path)) as f:
+    return set(os.path.realpath(line.strip()) for line in f if line.strip())
+
+
+def _GetAffectedTranslationUnits(sections, build_dir, changed_files):
+  """Returns (affected TUs, all TUs) of the dependency index in |sections|."""
+  affected_tus = set()
+  all_tus = set()
+  for line in sections[DEPENDENCIES_SECTION]:
+    tu, separator, dependency = line.partition(':::')
+    if not separator:
+      raise InputError('Unexpected DEPENDENCIES line: %s' % line)
+    all_tus.add(tu)
+    # Paths of the dependencies are relative to the build directory (unless
+    # they are absolute).
+    if os.path.realpath(os.path.join(build_dir, dependency)) in changed_files:
+      affected_tus.add(tu)
+  return affected_tus, all_tus
+
+
+def _AffectedTranslationUnits(args):
+  sections = _ReadSectionsFromFile(args.previous_output)
+  if not sections[DEPENDENCIES_SECTION]:
+    raise InputError('%s has no DEPENDENCIES; please run the rewriter with '
+                     '--emit-dependencies' % args.previous_output)
+  changed_files = _ReadChangedFiles(args.changed_files)
+  affected_tus, all_tus = _GetAffectedTranslationUnits(
+      sections, args.build_dir, changed_files)
+
+  indexed_files = set(os.path.realpath(tu) for tu in all_tus)
+  for path in changed_files:
+    if (path.endswith(SOURCE_EXTENSIONS) and path not in indexed_files
+        and os.path.exists(path)):
+      affected_tus.add(path)
+
+  for tu in sorted(affected_tus):
+    print(tu)
+  return 0
+
+
+def _IsEditOfChangedFile(section, line, build_dir, changed_files):
+  parts = line.split(':::', EDIT_PATH_INDEX[section] + 1)
+  if len(parts) <= EDIT_PATH_INDEX[section]:
+    raise InputError('Unexpected %s line: %s' % (section, line))
+  path = parts[EDIT_PATH_INDEX[section]]
+  return os.path.realpath(os.path.join(build_dir, path)) in changed_files
+
+
+def _Merge(args):
+  previous_sections = _ReadSectionsFromFile(args.previous_output)
+  new_sections = _ReadSections(sys.stdin)
+  changed_files = _ReadChangedFiles(args.changed_files)
+
+  # The dependencies of the affected translation units come from the new
+  # output (the translation units might not even exist anymore).
+  affected_tus, _ = _GetAffectedTranslationUnits(previous_sections,
+                                                 args.build_dir, changed_files)
+  rerun_tus = set(
+      line.partition(':::')[0] for line in new_sections[DEPENDENCIES_SECTION])
+  stale_tus = affected_tus | rerun_tus
+
+  merged_sections = collections.defaultdict(set)
+  for section, lines in previous_sections.items():
+    for line in lines:
+      if section in EDIT_PATH_INDEX:
+        if _IsEditOfChangedFile(section, line, args.build_dir, changed_files):
+          continue
+      elif section == DEPENDENCIES_SECTION:
+        if line.partition(':::')[0] in stale_tus:
+          continue
+      merged_sections[section].add(line)
+  for section, lines in new_sections.items():
+    merged_sections[section].update(lines)
+
+  sorted_sections = [s for s in SECTION_ORDER if s in merged_sections]
+  sorted_sections += sorted(
+      s for s in merged_sections if s not in SECTION_ORDER)
+  for section in sorted_sections:
+    if not merged_sections[section]:
+      continue
+    print('==== BEGIN %s ====' % section)
+    for line in sorted(merged_sections[section]):
+      print(line)
+    print('==== END %s ====' % section)
+  return 0
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('command', choices=['affected-tus', 'merge'])
+  parser.add_argument('-p',
+                      dest='build_dir',
+                      required=True,
+                      help='build directory that the rewriter was run with '
+                      '(paths of dependencies and edits are relative to it)')
+  parser.add_argument('--previous-output',
+                      required=True,
+                      help='output of the previous rewriter run (with '
+                      '--emit-dependencies)')
+  parser.add_argument('--changed-files',
+                      required=True,
+                      help='file listing the changed files (relative to the '
+                      'current directory), one per line')
+  args = parser.parse_args()
+
+  try:
+    if args.command == 'affected-tus':
+      return _AffectedTranslationUnits(args)
+    return _Merge(args)
+  except InputError as e:
+    sys.stderr.write('ERROR: %s\n' % e)
+    return 1
+
+
+if __name__ == '__main__':
+  sys.exit(main())
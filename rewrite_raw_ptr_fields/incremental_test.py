@@ -0,0 +1,174 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+import argparse
+import os
+import shutil
+import sys
+import tempfile
+import unittest
+
+try:
+  from StringIO import StringIO  # Python 2
+except ImportError:
+  from io import StringIO
+
+import incremental
+
+
+class IsEditOfChangedFileTest(unittest.TestCase):
+  def setUp(self):
+    self.build_dir = os.path.realpath('/src/out/dir')
+    self.changed_files = set([os.path.realpath('/src/foo/bar.h')])
+
+  def _IsEditOfChangedFile(self, section, line):
+    return incremental._IsEditOfChangedFile(section, line, self.build_dir,
+                                            self.changed_files)
+
+  def testEdit(self):
+    self.assertTrue(
+        self._IsEditOfChangedFile(
+            'EDITS', 'r:::../../foo/bar.h:::123:::4:::raw_ptr<Foo>'))
+    self.assertFalse(
+        self._IsEditOfChangedFile(
+            'EDITS', 'r:::../../foo/baz.h:::123:::4:::raw_ptr<Foo>'))
+
+  def testAbsolutePath(self):
+    self.assertTrue(
+        self._IsEditOfChangedFile('EDITS',
+                                  'r:::/src/foo/bar.h:::123:::4:::raw_ptr<Foo>'))
+
+  def testFieldEdit(self):
+    # The qualified field name contains '::', but not ':::'.
+    self.assertTrue(
+        self._IsEditOfChangedFile(
+            'FIELD EDITS',
+            'ns::Bar::foo_:::r:::../../foo/bar.h:::123:::4:::raw_ptr<Foo>'))
+    self.assertFalse(
+        self._IsEditOfChangedFile(
+            'FIELD EDITS',
+            'ns::Baz::foo_:::r:::../../foo/baz.h:::123:::4:::raw_ptr<Foo>'))
+
+  def testIncludeEdit(self):
+    self.assertTrue(
+        self._IsEditOfChangedFile(
+            'EDITS',
+            'include-user-header:::../../foo/bar.h:::-1:::-1:::base/raw_ptr.h'))
+
+  def testMalformedEdit(self):
+    with self.assertRaises(incremental.InputError):
+      self._IsEditOfChangedFile('EDITS', 'r')
+    with self.assertRaises(incremental.InputError):
+      self._IsEditOfChangedFile('FIELD EDITS', 'ns::Bar::foo_:::r')
+
+
+class MergeTest(unittest.TestCase):
+  def setUp(self):
+    self.src_dir = os.path.realpath(tempfile.mkdtemp())
+    self.build_dir = os.path.join(self.src_dir, 'out', 'dir')
+    os.makedirs(self.build_dir)
+    self.previous_output = os.path.join(self.src_dir, 'rewriter.out')
+    self.changed_files = os.path.join(self.src_dir, 'changed-files.txt')
+
+  def tearDown(self):
+    shutil.rmtree(self.src_dir)
+
+  def _Path(self, path):
+    return os.path.join(self.src_dir, path)
+
+  def _WriteFile(self, path, lines):
+    with open(path, 'w') as f:
+      f.write(''.join(line + '\n' for line in lines))
+
+  def _Merge(self, previous_lines, changed_files, new_lines):
+    self._WriteFile(self.previous_output, previous_lines)
+    self._WriteFile(self.changed_files,
+                    [self._Path(path) for path in changed_files])
+    args = argparse.Namespace(build_dir=self.build_dir,
+                              previous_output=self.previous_output,
+                              changed_files=self.changed_files)
+    stdin, stdout = sys.stdin, sys.stdout
+    sys.stdin = StringIO(''.join(line + '\n' for line in new_lines))
+    sys.stdout = StringIO()
+    try:
+      self.assertEqual(0, incremental._Merge(args))
+      return sys.stdout.getvalue().splitlines()
+    finally:
+      sys.stdin, sys.stdout = stdin, stdout
+
+  def testEditsOfChangedFilesAreReplaced(self):
+    a_cc = self._Path('a.cc')
+    previous = [
+        '==== BEGIN EDITS ====',
+        'r:::../../a.cc:::10:::4:::raw_ptr<A>',
+        'r:::../../common.h:::20:::4:::raw_ptr<C>',
+        '==== END EDITS ====',
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../common.h',
+        '==== END DEPENDENCIES ====',
+    ]
+    new = [
+        '==== BEGIN EDITS ====',
+        'r:::../../a.cc:::15:::4:::raw_ptr<A>',
+        '==== END EDITS ====',
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../common.h',
+        '==== END DEPENDENCIES ====',
+    ]
+    self.assertEqual([
+        '==== BEGIN EDITS ====',
+        'r:::../../a.cc:::15:::4:::raw_ptr<A>',
+        'r:::../../common.h:::20:::4:::raw_ptr<C>',
+        '==== END EDITS ====',
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../common.h',
+        '==== END DEPENDENCIES ====',
+    ], self._Merge(previous, ['a.cc'], new))
+
+  def testStaleTranslationUnits(self):
+    a_cc = self._Path('a.cc')
+    b_cc = self._Path('b.cc')
+    c_cc = self._Path('c.cc')
+    previous = [
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../old.h',
+        b_cc + ':::../../b.cc',
+        b_cc + ':::../../old.h',
+        c_cc + ':::../../c.cc',
+        '==== END DEPENDENCIES ====',
+        '==== BEGIN FIELD FILTERS ====',
+        'A::a_  # addr-of',
+        '==== END FIELD FILTERS ====',
+    ]
+    # a.cc no longer includes old.h and b.cc doesn't exist anymore, so the
+    # dependencies of both come only from the new output (i.e. b.cc has none).
+    new = [
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../new.h',
+        '==== END DEPENDENCIES ====',
+        '==== BEGIN FIELD FILTERS ====',
+        'A::b_  # addr-of',
+        '==== END FIELD FILTERS ====',
+    ]
+    self.assertEqual([
+        '==== BEGIN DEPENDENCIES ====',
+        a_cc + ':::../../a.cc',
+        a_cc + ':::../../new.h',
+        c_cc + ':::../../c.cc',
+        '==== END DEPENDENCIES ====',
+        '==== BEGIN FIELD FILTERS ====',
+        'A::a_  # addr-of',
+        'A::b_  # addr-of',
+        '==== END FIELD FILTERS ====',
+    ], self._Merge(previous, ['a.cc', 'b.cc', 'old.h'], new))
+
+
+if __name__ == '__main__':
+  unittest.main()
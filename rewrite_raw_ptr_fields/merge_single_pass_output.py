@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Merges the output of rewrite_raw_ptr_fields --single-pass.
+
+In --single-pass mode the rewriter emits each edit prefixed with the qualified
+name of the field that the edit belongs to:
+    ==== BEGIN FIELD EDITS ====
+    ns::MyStruct::ptr_field_:::r:::path/to/file.h:::123:::4:::raw_ptr<T>
+    ==== END FIELD EDITS ====
+together with the usual list of fields that shouldn't be rewritten:
+    ==== BEGIN FIELD FILTERS ====
+    ns::OtherStruct::other_field_  # addr-of
+    ==== END FIELD FILTERS ====
+
+This script takes the output concatenated from all the rewriter invocations,
+drops the edits of fields that were filtered out by any of them (or that are
+listed in one of the --exclude-fields files), and prints the remaining edits in
+the format expected by apply_edits.py (i.e. the same as extract_edits.py).
+
+Example usage:
+    $ cat ~/scratch/rewriter.out \\
+        | merge_single_pass_output.py \\
+              --exclude-fields=.../manual-fields-to-ignore.txt \\
+              --fields-to-ignore-output=~/scratch/fields-to-ignore.txt \\
+        | apply_edits.py -p out/dir .
+"""
+
+import argparse
+import sys
+
+FIELD_EDITS_SECTION = 'FIELD EDITS'
+FIELD_FILTERS_SECTION = 'FIELD FILTERS'
+
+
+def _StripComment(line):
+  """Strips '#' comments (e.g. filter tags) and surrounding whitespace."""
+  return line.split('#', 1)[0].strip()
+
+
+def _ReadSections(lines):
+  """Yields (section name, line) pairs for all lines within output sections."""
+  current_section = None
+  for line in lines:
+    line = line.rstrip('\n\r')
+    if line.startswith('==== BEGIN ') and line.endswith(' ===='):
+      current_section = line[len('==== BEGIN '):-len(' ====')]
+      continue
+    if line.startswith('==== END ') and line.endswith(' ===='):
+      current_section = None
+      continue
+    if current_section is not None:
+      yield current_section, line
+
+
+def _ReadFilterFile(path):
+  """Returns the set of fields listed in an --exclude-fields file."""
+  with open(path) as f:
+    return set(filter(None, (_StripComment(line) for line in f)))
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--exclude-fields',
+                      action='append',
+                      default=[],
+                      help='file listing additional fields to be blocked '
+                      '(e.g. manual-fields-to-ignore.txt); can be repeated')
+  parser.add_argument('--fields-to-ignore-output',
+                      help='file to write the combined list of blocked '
+                      'fields to')
+  args = parser.parse_args()
+
+  fields_to_ignore = set()
+  for path in args.exclude_fields:
+    fields_to_ignore.update(_ReadFilterFile(path))
+
+  # The edits of a given field may come from many translation units, while its
+  # filters may come from yet another translation unit, so nothing can be
+  # printed until the whole input has been read.
+  field_edits = []
+  for section, line in _ReadSections(sys.stdin):
+    if section == FIELD_FILTERS_SECTION:
+      field = _StripComment(line)
+      if field:
+        fields_to_ignore.add(field)
+    elif section == FIELD_EDITS_SECTION:
+      field, separator, edit = line.partition(':::')
+      if not separator:
+        sys.stderr.write('ERROR: Unexpected FIELD EDITS line: %s\n' % line)
+        return 1
+      field_edits.append((field, edit))
+
+  unique_edits = set()
+  for field, edit in field_edits:
+    if field in fields_to_ignore or edit in unique_edits:
+      continue
+    unique_edits.add(edit)
+    print(edit)
+
+  if args.fields_to_ignore_output:
+    with open(args.fields_to_ignore_output, 'w') as f:
+      for field in sorted(fields_to_ignore):
+        f.write(field + '\n')
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
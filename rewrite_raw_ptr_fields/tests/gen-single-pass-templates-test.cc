@@ -0,0 +1,36 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file (and other gen-*-test.cc files) tests generation of output for
+// --field-filter-file and therefore the expectations file
+// (gen-single-pass-templates-expected.txt) needs to be compared against the
+// raw output of the rewriter (rather than against the actual edits result).
+//
+// gen-single-pass-*-test.cc files are run with --single-pass, so the edits are
+// emitted as FIELD EDITS keyed by the qualified name of the explicit field
+// (rather than of the field of an implicit template instantiation) - this is
+// what allows merge_single_pass_output.py to drop the edits of the filtered
+// fields.
+//
+// To run the test use tools/clang/rewrite_raw_ptr_fields/tests/run_all_tests.py
+
+namespace my_namespace {
+
+template <typename T>
+struct MyTemplate {
+  T* excluded_ptr;
+  T* ptr;
+};
+
+void foo(MyTemplate<int>& s) {
+  // Expected FIELD FILTERS line: my_namespace::MyTemplate::excluded_ptr
+  int** addr = &s.excluded_ptr;
+
+  // Expected FIELD EDITS lines keyed by my_namespace::MyTemplate::excluded_ptr
+  // and my_namespace::MyTemplate::ptr (rather than by MyTemplate<int>).
+  const int* v1 = const_cast<const int*>(s.excluded_ptr);
+  const int* v2 = const_cast<const int*>(s.ptr);
+}
+
+}  // namespace my_namespace
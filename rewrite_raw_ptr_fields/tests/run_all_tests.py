@@ -21,12 +21,16 @@ def RunGeneratingTest(test_path):
   tmp_test_path = test_path.replace("-test.cc", "-original.cc")
   test_filter = os.path.basename(test_path).replace("-test.cc", "")
 
+  args = ["--test-filter=%s" % test_filter]
+  # gen-single-pass-*-test.cc expectations contain FIELD EDITS instead of
+  # EDITS.
+  if test_filter.startswith("gen-single-pass-"):
+    args.append("--tool-arg=--single-pass")
+
   shutil.copyfile(test_path, tmp_test_path)
   try:
-    subprocess.run([
-        "tools/clang/scripts/test_tool.py",
-        "--test-filter=%s" % test_filter, "rewrite_raw_ptr_fields"
-    ])
+    subprocess.run(["tools/clang/scripts/test_tool.py"] + args +
+                   ["rewrite_raw_ptr_fields"])
   finally:
     os.remove(tmp_test_path)
 
@@ -4,14 +4,23 @@
 
 #include "EditTracker.h"
 
-#include <assert.h>
 #include <stdio.h>
+#include <algorithm>
+#include <tuple>
+
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace {
 
-const char* GetTag(RenameCategory category) {
+uint64_t Pack(uint32_t high, uint32_t low) {
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+}  // namespace
+
+const char* GetRenameCategoryTag(RenameCategory category) {
   switch (category) {
     case RenameCategory::kEnumValue:
       return "enum";
@@ -26,37 +35,106 @@ const char* GetTag(RenameCategory category) {
   }
 }
 
-}  // namespace
+// "TEDB" when read as little-endian bytes.
+const uint32_t EditTracker::kIndexMagic = 0x42444554;
+const uint32_t EditTracker::kIndexVersion = 1;
 
-EditTracker::EditTracker(RenameCategory category) : category_(category) {}
+EditTracker::EditTracker() = default;
 
-void EditTracker::Add(const clang::SourceManager& source_manager,
-                      clang::SourceLocation location,
+EditTracker::~EditTracker() = default;
+
+void EditTracker::Add(llvm::StringRef filename,
+                      RenameCategory category,
                       llvm::StringRef original_text,
                       llvm::StringRef new_text) {
-  llvm::StringRef filename;
-  for (int i = 0; i < 10; i++) {
-    filename = source_manager.getFilename(location);
-    if (!filename.empty() || !location.isMacroID())
-      break;
-    // Otherwise, no filename and the SourceLocation is a macro ID. Look one
-    // level up the stack...
-    location = source_manager.getImmediateMacroCallerLoc(location);
+  uint32_t filename_index = InternString(filename);
+  uint32_t tag = InternString(GetRenameCategoryTag(category));
+  uint32_t original_text_index = InternString(original_text);
+  auto result = new_texts_.try_emplace(
+      std::make_pair(static_cast<unsigned>(category), original_text_index),
+      0);
+  if (result.second)
+    result.first->second = InternString(new_text);
+  tracked_edits_.insert(
+      std::make_pair(Pack(filename_index, tag),
+                     Pack(original_text_index, result.first->second)));
+}
+
+void EditTracker::SerializeTo(llvm::raw_ostream& output) const {
+  std::vector<llvm::StringRef> strings;
+  for (const UnpackedEdit& edit : GetSortedEdits(&strings)) {
+    output << strings[edit.filename] << ":" << strings[edit.tag] << ":"
+           << strings[edit.original_text] << ":" << strings[edit.new_text]
+           << "\n";
   }
-  assert(!filename.empty() && "Can't track edit with no filename!");
-  auto result = tracked_edits_.try_emplace(original_text);
-  if (result.second) {
-    result.first->getValue().new_text = new_text;
+}
+
+void EditTracker::WriteIndexTo(llvm::raw_ostream& output) const {
+  std::vector<llvm::StringRef> strings;
+  std::vector<UnpackedEdit> edits = GetSortedEdits(&strings);
+
+  llvm::support::endian::Writer writer(output, llvm::support::little);
+  writer.write<uint32_t>(kIndexMagic);
+  writer.write<uint32_t>(kIndexVersion);
+  writer.write<uint32_t>(strings.size());
+  writer.write<uint32_t>(edits.size());
+
+  uint32_t offset = 0;
+  writer.write<uint32_t>(offset);
+  for (llvm::StringRef str : strings) {
+    offset += str.size();
+    writer.write<uint32_t>(offset);
+  }
+
+  for (const UnpackedEdit& edit : edits) {
+    writer.write<uint32_t>(edit.filename);
+    writer.write<uint32_t>(edit.tag);
+    writer.write<uint32_t>(edit.original_text);
+    writer.write<uint32_t>(edit.new_text);
   }
-  result.first->getValue().filenames.try_emplace(filename);
+
+  for (llvm::StringRef str : strings)
+    output << str;
 }
 
-void EditTracker::SerializeTo(llvm::raw_ostream& output) const {
-  const char* tag = GetTag(category_);
-  for (const auto& edit : tracked_edits_) {
-    for (const auto& filename : edit.getValue().filenames) {
-      output << filename.getKey() << ":" << tag << ":" << edit.getKey() << ":"
-             << edit.getValue().new_text << "\n";
-    }
+uint32_t EditTracker::InternString(llvm::StringRef str) {
+  auto result = string_ids_.try_emplace(str, strings_.size());
+  if (result.second)
+    strings_.push_back(result.first->getKey());
+  return result.first->getValue();
+}
+
+std::vector<EditTracker::UnpackedEdit> EditTracker::GetSortedEdits(
+    std::vector<llvm::StringRef>* sorted_strings) const {
+  std::vector<uint32_t> order(strings_.size());
+  for (uint32_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+    return strings_[lhs] < strings_[rhs];
+  });
+
+  std::vector<uint32_t> sorted_index(strings_.size());
+  sorted_strings->clear();
+  sorted_strings->reserve(strings_.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    sorted_index[order[i]] = i;
+    sorted_strings->push_back(strings_[order[i]]);
+  }
+
+  std::vector<UnpackedEdit> edits;
+  edits.reserve(tracked_edits_.size());
+  for (const TrackedEdit& edit : tracked_edits_) {
+    edits.push_back({sorted_index[edit.first >> 32],
+                     sorted_index[edit.first & 0xffffffff],
+                     sorted_index[edit.second >> 32],
+                     sorted_index[edit.second & 0xffffffff]});
   }
+  std::sort(edits.begin(), edits.end(),
+            [](const UnpackedEdit& lhs, const UnpackedEdit& rhs) {
+              return std::tie(lhs.filename, lhs.original_text, lhs.tag,
+                              lhs.new_text) <
+                     std::tie(rhs.filename, rhs.original_text, rhs.tag,
+                              rhs.new_text);
+            });
+  return edits;
 }
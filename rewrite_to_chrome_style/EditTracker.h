@@ -5,23 +5,19 @@
 #ifndef TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_EDIT_TRACKER_H_
 #define TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_EDIT_TRACKER_H_
 
-#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
 
-#include "clang/Basic/SourceLocation.h"
-#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/ADT/StringSet.h"
 
 namespace llvm {
 class raw_ostream;
 }  // namespace llvm
 
-struct EditInfo {
-  std::string new_text;
-  llvm::StringSet<> filenames;
-};
-
 enum class RenameCategory {
   kEnumValue,
   kField,
@@ -30,30 +26,77 @@ enum class RenameCategory {
   kVariable,
 };
 
-// Simple class that tracks the edits made by path. Used to dump the databaes
-// used by the Blink rebase helper.
+// Returns the tag identifying |category| in the serialized edits.
+const char* GetRenameCategoryTag(RenameCategory category);
+
+// Simple class that tracks the edits made by path. Used to dump the database
+// used by the Blink rebase helper.  A single tracker is shared by all the
+// rewriters; filenames, tags and edited texts are interned, so each distinct
+// edit of a file is stored only once.
+//
+// The tracked edits can be written in two formats:
+// - SerializeTo emits text lines, sorted by filename:
+//     <filename>:<tag>:<original text>:<new text>
+// - WriteIndexTo emits an index that can be mmapped and binary searched
+//   without parsing it first (see query_tracked_edits.py).  All the numbers are
+//   little-endian uint32s:
+//     <magic> <version> <string count> <edit count>
+//     <string offsets>  (string count + 1 of them, relative to the string data)
+//     <edits>           (4 string indices each: filename, tag, original text,
+//                        new text)
+//     <string data>
+//   The strings are sorted, so are the edits (by filename, original text, tag
+//   and new text), so all the edits of a filename are adjacent.
 class EditTracker {
  public:
-  explicit EditTracker(RenameCategory category);
+  static const uint32_t kIndexMagic;
+  static const uint32_t kIndexVersion;
 
-  void Add(const clang::SourceManager& source_manager,
-           clang::SourceLocation location,
+  EditTracker();
+  ~EditTracker();
+
+  void Add(llvm::StringRef filename,
+           RenameCategory category,
            llvm::StringRef original_text,
            llvm::StringRef new_text);
 
-  // Serializes the tracked edits to |output|. Emits:
-  // <filename>:<tag>:<original text>:<new text>
-  // for each distinct filename for each tracked edit.
+  // Serializes the tracked edits to |output| in the text format.
   void SerializeTo(llvm::raw_ostream& output) const;
 
+  // Serializes the tracked edits to |output| in the index format.
+  void WriteIndexTo(llvm::raw_ostream& output) const;
+
  private:
   EditTracker(const EditTracker&) = delete;
   EditTracker& operator=(const EditTracker&) = delete;
 
-  // The string key is the original text.
-  llvm::StringMap<EditInfo> tracked_edits_;
+  // Indices into |strings_| of the filename and tag (first) and of the
+  // original and new texts (second), packed as pairs of uint32s.
+  using TrackedEdit = std::pair<uint64_t, uint64_t>;
+
+  struct UnpackedEdit {
+    uint32_t filename;
+    uint32_t tag;
+    uint32_t original_text;
+    uint32_t new_text;
+  };
+
+  uint32_t InternString(llvm::StringRef str);
+
+  // Returns the tracked edits with string indices remapped so that they follow
+  // the order of the strings, sorted.  |sorted_strings| receives the strings.
+  std::vector<UnpackedEdit> GetSortedEdits(
+      std::vector<llvm::StringRef>* sorted_strings) const;
+
+  // Interned strings.  The StringRefs point into the keys of |string_ids_|.
+  llvm::StringMap<uint32_t> string_ids_;
+  std::vector<llvm::StringRef> strings_;
+
+  // The first new text for each (category, original text) pair.  Other new
+  // texts of the same original text are ignored.
+  llvm::DenseMap<std::pair<unsigned, uint32_t>, uint32_t> new_texts_;
 
-  RenameCategory category_;
+  llvm::DenseSet<TrackedEdit> tracked_edits_;
 };
 
 #endif  // #define TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_EDIT_TRACKER_H_
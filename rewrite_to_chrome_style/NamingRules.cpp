@@ -0,0 +1,174 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "NamingRules.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <memory>
+
+#include "clang/Basic/CharInfo.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+std::string CamelCaseToUnderscoreCase(llvm::StringRef input) {
+  std::string output;
+  bool needs_underscore = false;
+  bool was_lowercase = false;
+  bool was_uppercase = false;
+  bool first_char = true;
+  // Iterate in reverse to minimize the amount of backtracking.
+  for (const unsigned char* i = input.bytes_end() - 1; i >= input.bytes_begin();
+       --i) {
+    char c = *i;
+    bool is_lowercase = clang::isLowercase(c);
+    bool is_uppercase = clang::isUppercase(c);
+    c = clang::toLowercase(c);
+    // Transitioning from upper to lower case requires an underscore. This is
+    // needed to handle names with acronyms, e.g. handledHTTPRequest needs a '_'
+    // in 'dH'. This is a complement to the non-acronym case further down.
+    if (was_uppercase && is_lowercase)
+      needs_underscore = true;
+    if (needs_underscore) {
+      output += '_';
+      needs_underscore = false;
+    }
+    output += c;
+    // Handles the non-acronym case: transitioning from lower to upper case
+    // requires an underscore when emitting the next character, e.g. didLoad
+    // needs a '_' in 'dL'.
+    if (!first_char && was_lowercase && is_uppercase)
+      needs_underscore = true;
+    was_lowercase = is_lowercase;
+    was_uppercase = is_uppercase;
+    first_char = false;
+  }
+  std::reverse(output.begin(), output.end());
+  return output;
+}
+
+NamingRules::NamingRules(const std::string& filepath) {
+  if (!filepath.empty())
+    ParseInputFile(filepath);
+}
+
+NamingRules::~NamingRules() = default;
+
+bool NamingRules::HasRules(Kind kind) const {
+  return std::any_of(rules_.begin(), rules_.end(),
+                     [kind](const Rule& rule) { return rule.kind == kind; });
+}
+
+bool NamingRules::GetNewName(Kind kind,
+                             llvm::StringRef old_name,
+                             std::string* new_name) const {
+  for (const Rule& rule : rules_) {
+    llvm::SmallVector<llvm::StringRef, 10> groups;
+    if (rule.kind != kind || !rule.pattern.match(old_name, &groups))
+      continue;
+
+    new_name->clear();
+    llvm::StringRef rest = rule.new_name;
+    while (!rest.empty()) {
+      size_t backslash = rest.find('\\');
+      new_name->append(rest.substr(0, backslash).str());
+      if (backslash == llvm::StringRef::npos)
+        break;
+
+      // \0 is the whole old name (captured as group 1, see Rule::pattern).
+      unsigned group = rest[backslash + 1] - '0' + 1;
+      rest = rest.substr(backslash + 2);
+      llvm::StringRef text = group < groups.size() ? groups[group] : "";
+      switch (rule.new_case) {
+        case Case::kKeep:
+          new_name->append(text.str());
+          break;
+        case Case::kSnakeCase:
+          if (!text.empty())
+            new_name->append(CamelCaseToUnderscoreCase(text));
+          break;
+        case Case::kUpperCamelCase:
+          if (!text.empty()) {
+            new_name->push_back(clang::toUppercase(text[0]));
+            new_name->append(text.substr(1).str());
+          }
+          break;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+void NamingRules::ParseInputFile(const std::string& filepath) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file_or_err =
+      llvm::MemoryBuffer::getFile(filepath);
+  if (std::error_code err = file_or_err.getError()) {
+    llvm::errs() << "ERROR: Cannot open the naming rules file: " << filepath
+                 << ": " << err.message() << "\n";
+    assert(false);
+    return;
+  }
+
+  llvm::line_iterator it(**file_or_err, true /* SkipBlanks */, '#');
+  for (; !it.is_at_eof(); ++it) {
+    llvm::StringRef line = it->trim();
+    if (line.empty())
+      continue;
+
+    // Split the line into ':::'-delimited parts.
+    const size_t kExpectedNumberOfParts = 4;
+    llvm::SmallVector<llvm::StringRef, kExpectedNumberOfParts> parts;
+    line.split(parts, ":::");
+    if (parts.size() != kExpectedNumberOfParts) {
+      llvm::errs() << "ERROR: Parsing error - expected "
+                   << kExpectedNumberOfParts
+                   << " ':::'-delimited parts: " << filepath << ":"
+                   << it.line_number() << ": " << line << "\n";
+      assert(false);
+      continue;
+    }
+
+    llvm::Optional<Kind> kind =
+        llvm::StringSwitch<llvm::Optional<Kind>>(parts[0].trim())
+            .Case("field", Kind::kField)
+            .Case("var", Kind::kVariable)
+            .Case("const", Kind::kConstant)
+            .Case("func", Kind::kFunction)
+            .Case("enum", Kind::kEnumValue)
+            .Default(llvm::None);
+    llvm::Optional<Case> new_case =
+        llvm::StringSwitch<llvm::Optional<Case>>(parts[3].trim())
+            .Case("keep", Case::kKeep)
+            .Case("snake_case", Case::kSnakeCase)
+            .Case("UpperCamelCase", Case::kUpperCamelCase)
+            .Default(llvm::None);
+    llvm::StringRef new_name = parts[2].trim();
+    bool has_invalid_reference = false;
+    for (size_t i = new_name.find('\\'); i != llvm::StringRef::npos;
+         i = new_name.find('\\', i + 2)) {
+      if (i + 1 == new_name.size() || !clang::isDigit(new_name[i + 1]))
+        has_invalid_reference = true;
+    }
+    llvm::Regex pattern(("^(" + parts[1].trim() + ")$").str());
+    std::string regex_error;
+    if (!kind || !new_case || has_invalid_reference ||
+        !pattern.isValid(regex_error)) {
+      llvm::errs() << "ERROR: Invalid naming rule: " << filepath << ":"
+                   << it.line_number() << ": " << line;
+      if (!regex_error.empty())
+        llvm::errs() << ": " << regex_error;
+      llvm::errs() << "\n";
+      assert(false);
+      continue;
+    }
+
+    rules_.push_back({*kind, std::move(pattern), new_name.str(), *new_case});
+  }
+}
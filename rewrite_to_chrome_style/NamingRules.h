@@ -0,0 +1,86 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_NAMING_RULES_H_
+#define TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_NAMING_RULES_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Regex.h"
+
+// Helper to convert from a camelCaseName to camel_case_name. It uses some
+// heuristics to try to handle acronyms in camel case names correctly.
+std::string CamelCaseToUnderscoreCase(llvm::StringRef input);
+
+// Renaming rules loaded from a file (see --naming-rules), so that several
+// mass-renames can share a single run of the tool (and a single parse of each
+// translation unit) instead of each needing a tool of its own.  The rules take
+// precedence over the built-in Blink to Chrome style conversion: the first
+// rule matching a name decides its new name, and only the names that no rule
+// matches are converted to Chrome style.  Names depending on template
+// parameters are matched against the rules of the kinds they most likely
+// resolve to (see GuessNameForUnresolvedDependentNode).
+//
+// Each line of the file describes a rule:
+//   <kind>:::<pattern>:::<new name>:::<case>
+// where
+// - <kind> is the kind of the renamed names: field, var, const, func or enum
+//   (const is for variables that are probably constants, see
+//   IsProbablyConst),
+// - <pattern> is an extended regular expression that has to match the whole
+//   old name,
+// - <new name> is the new name, where \0 stands for the whole old name and \1
+//   to \9 stand for the groups captured by <pattern>,
+// - <case> is applied to the text substituted for \0 to \9: keep,
+//   snake_case (fooBar -> foo_bar) or UpperCamelCase (fooBar -> FooBar).
+// Example:
+//   field:::m_legacy(.*):::\1_:::snake_case
+class NamingRules {
+ public:
+  enum class Kind {
+    kField,
+    kVariable,
+    kConstant,
+    kFunction,
+    kEnumValue,
+  };
+
+  // An empty |filepath| means no rules.
+  explicit NamingRules(const std::string& filepath);
+  ~NamingRules();
+
+  NamingRules(const NamingRules&) = delete;
+  NamingRules& operator=(const NamingRules&) = delete;
+
+  bool empty() const { return rules_.empty(); }
+  bool HasRules(Kind kind) const;
+
+  // Returns false if no rule of |kind| matches |old_name|.  Thread-safe.
+  bool GetNewName(Kind kind,
+                  llvm::StringRef old_name,
+                  std::string* new_name) const;
+
+ private:
+  enum class Case {
+    kKeep,
+    kSnakeCase,
+    kUpperCamelCase,
+  };
+
+  struct Rule {
+    Kind kind;
+    // |pattern| wrapped in ^(...)$, so the whole pattern is group 1.
+    llvm::Regex pattern;
+    std::string new_name;
+    Case new_case;
+  };
+
+  void ParseInputFile(const std::string& filepath);
+
+  std::vector<Rule> rules_;
+};
+
+#endif  // TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_NAMING_RULES_H_
@@ -0,0 +1,340 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "RenameTable.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/Index/USRGeneration.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+// Returns the declaration whose name is changed by renaming |decl|.
+const clang::NamedDecl& GetRenamedDecl(const clang::NamedDecl& decl) {
+  // A using declaration is renamed together with the declaration it brings in
+  // (see also GetNameForDecl(const clang::UsingDecl&, ...)).
+  if (auto* using_decl = clang::dyn_cast<clang::UsingDecl>(&decl)) {
+    if (using_decl->shadow_size() > 0)
+      return *using_decl->shadow_begin()->getTargetDecl();
+  }
+  return decl;
+}
+
+// Returns the member of the class template that |decl| was instantiated from,
+// or |decl| if it isn't a member of a template instantiation.  The members of
+// each specialization have their own USRs, but they are all renamed by
+// renaming the member of the template.
+const clang::NamedDecl& GetInstantiationPattern(const clang::NamedDecl& decl) {
+  if (auto* function = clang::dyn_cast<clang::FunctionDecl>(&decl)) {
+    // Also covers getInstantiatedFromMemberFunction() and function templates.
+    if (const clang::FunctionDecl* pattern =
+            function->getTemplateInstantiationPattern(
+                /*ForDefinition=*/false)) {
+      return *pattern;
+    }
+  } else if (auto* var = clang::dyn_cast<clang::VarDecl>(&decl)) {
+    if (const clang::VarDecl* pattern =
+            var->getInstantiatedFromStaticDataMember()) {
+      return *pattern;
+    }
+  } else if (auto* field = clang::dyn_cast<clang::FieldDecl>(&decl)) {
+    // Fields don't point back to the field they were instantiated from, so look
+    // it up by name in the instantiated record.
+    auto* record = clang::dyn_cast<clang::CXXRecordDecl>(field->getParent());
+    const clang::CXXRecordDecl* pattern =
+        record ? record->getTemplateInstantiationPattern() : nullptr;
+    if (pattern && field->getDeclName()) {
+      for (const clang::NamedDecl* member :
+           pattern->lookup(field->getDeclName())) {
+        if (clang::isa<clang::FieldDecl>(member))
+          return *member;
+      }
+    }
+  }
+  return decl;
+}
+
+}  // namespace
+
+TranslationUnitRenames::TranslationUnitRenames() = default;
+
+TranslationUnitRenames::~TranslationUnitRenames() = default;
+
+TranslationUnitRenames::TranslationUnitRenames(TranslationUnitRenames&&) =
+    default;
+
+TranslationUnitRenames& TranslationUnitRenames::operator=(
+    TranslationUnitRenames&&) = default;
+
+bool TranslationUnitRenames::ClaimLocation(
+    const clang::SourceManager& source_manager,
+    clang::SourceLocation spelling_loc) {
+  return claimed_locations_
+      .insert(source_manager.getDecomposedLoc(spelling_loc))
+      .second;
+}
+
+void TranslationUnitRenames::Add(const clang::SourceManager& source_manager,
+                                 clang::SourceLocation location,
+                                 const clang::NamedDecl* decl,
+                                 RenameCategory category,
+                                 llvm::StringRef old_name,
+                                 llvm::StringRef new_name,
+                                 clang::tooling::Replacement replacement) {
+  ProposedRename rename;
+  if (decl) {
+    const clang::NamedDecl& renamed_decl = GetRenamedDecl(*decl);
+    rename.usr = GetUSR(renamed_decl);
+    if (auto* method = clang::dyn_cast<clang::CXXMethodDecl>(&renamed_decl))
+      AddOverriddenMethods(*method);
+  }
+  rename.category = category;
+  rename.old_name = old_name.str();
+  rename.new_name = new_name.str();
+  rename.tracked_filename = GetTrackedFilename(source_manager, location);
+  rename.replacement = std::move(replacement);
+  renames_.push_back(std::move(rename));
+}
+
+void TranslationUnitRenames::AddConflict(const clang::CXXMethodDecl& method) {
+  const std::string& usr = GetUSR(method);
+  if (usr.empty())
+    return;
+  conflicts_.push_back(usr);
+  AddOverriddenMethods(method);
+}
+
+const std::string& TranslationUnitRenames::GetUSR(
+    const clang::NamedDecl& decl) {
+  const clang::Decl* canonical_decl =
+      GetInstantiationPattern(decl).getCanonicalDecl();
+  auto it = usrs_.find(canonical_decl);
+  if (it != usrs_.end())
+    return it->second;
+
+  llvm::SmallString<128> usr;
+  if (clang::index::generateUSRForDecl(canonical_decl, usr))
+    usr.clear();  // Failed to generate the USR.
+  return usrs_.try_emplace(canonical_decl, usr.str().str()).first->second;
+}
+
+const std::string& TranslationUnitRenames::GetTrackedFilename(
+    const clang::SourceManager& source_manager,
+    clang::SourceLocation location) {
+  clang::FileID file_id = source_manager.getFileID(location);
+  auto it = tracked_filenames_.find(file_id);
+  if (it != tracked_filenames_.end())
+    return it->second;
+
+  llvm::StringRef filename;
+  for (int i = 0; i < 10; i++) {
+    filename = source_manager.getFilename(location);
+    if (!filename.empty() || !location.isMacroID())
+      break;
+    // Otherwise, no filename and the SourceLocation is a macro ID. Look one
+    // level up the stack...
+    location = source_manager.getImmediateMacroCallerLoc(location);
+  }
+  assert(!filename.empty() && "Can't track edit with no filename!");
+  return tracked_filenames_.try_emplace(file_id, filename.str())
+      .first->second;
+}
+
+void TranslationUnitRenames::AddOverriddenMethods(
+    const clang::CXXMethodDecl& method) {
+  const clang::CXXMethodDecl* canonical_method = method.getCanonicalDecl();
+  if (!methods_with_overrides_.insert(canonical_method).second)
+    return;
+
+  const std::string& usr = GetUSR(*canonical_method);
+  if (usr.empty())
+    return;
+  for (const clang::CXXMethodDecl* overridden_method :
+       canonical_method->overridden_methods()) {
+    const std::string& overridden_usr = GetUSR(*overridden_method);
+    if (!overridden_usr.empty())
+      overrides_.emplace_back(usr, overridden_usr);
+    // Methods that are not renamed themselves still connect the methods that
+    // override them.
+    AddOverriddenMethods(*overridden_method);
+  }
+}
+
+RenameTable::RenameTable() = default;
+
+RenameTable::~RenameTable() = default;
+
+void RenameTable::AddTranslationUnit(TranslationUnitRenames renames) {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (ProposedRename& rename : renames.renames_)
+    AddRename(std::move(rename));
+  for (const auto& override_pair : renames.overrides_) {
+    Union(GetDeclIndex(override_pair.first),
+          GetDeclIndex(override_pair.second));
+  }
+  for (const std::string& usr : renames.conflicts_) {
+    AddConflict(GetDeclIndex(usr),
+                "overrides some methods that would be renamed and some that "
+                "wouldn't");
+  }
+}
+
+size_t RenameTable::Resolve(llvm::raw_ostream& errors,
+                            std::set<clang::tooling::Replacement>* replacements,
+                            EditTracker* edit_tracker) {
+  std::lock_guard<std::mutex> guard(lock_);
+
+  // A conflict of any declaration prevents renaming all the declarations that
+  // need to be renamed together with it.
+  std::vector<const std::string*> root_conflicts(decls_.size(), nullptr);
+  for (unsigned i = 0; i < decls_.size(); i++) {
+    if (decls_[i].conflict.empty())
+      continue;
+    unsigned root = FindRoot(i);
+    if (!root_conflicts[root])
+      root_conflicts[root] = &decls_[i].conflict;
+  }
+
+  // Names depending on template parameters are not bound to a declaration, so
+  // they are not renamed if any declaration with the same name isn't.
+  llvm::StringSet<> blocked_old_names;
+  std::vector<unsigned> blocked_decls;
+  for (unsigned i = 0; i < decls_.size(); i++) {
+    if (!root_conflicts[FindRoot(i)] || decls_[i].old_name.empty())
+      continue;
+    blocked_old_names.insert(decls_[i].old_name);
+    blocked_decls.push_back(i);
+  }
+  for (DeclInfo& decl : decls_)
+    decl.renamed = !decl.old_name.empty();
+  for (unsigned i : blocked_decls)
+    decls_[i].renamed = false;
+
+  for (const auto& entry : location_edits_) {
+    const LocationEdit& edit = entry.getValue();
+    if (edit.has_conflict)
+      continue;
+    if (edit.decl_index == kNoUSR) {
+      if (blocked_old_names.count(edit.old_name))
+        continue;
+    } else if (root_conflicts[FindRoot(edit.decl_index)]) {
+      continue;
+    }
+    replacements->insert(edit.replacement);
+    edit_tracker->Add(edit.tracked_filename, edit.category, edit.old_name,
+                      edit.new_name);
+  }
+
+  std::sort(blocked_decls.begin(), blocked_decls.end(),
+            [this](unsigned lhs, unsigned rhs) {
+              return decls_[lhs].usr < decls_[rhs].usr;
+            });
+  for (unsigned i : blocked_decls) {
+    errors << "WARNING: Not renaming " << decls_[i].old_name << " ("
+           << decls_[i].usr << "): " << *root_conflicts[FindRoot(i)] << "\n";
+  }
+  return blocked_decls.size();
+}
+
+void RenameTable::SerializeRenameMapTo(llvm::raw_ostream& output) const {
+  std::vector<const DeclInfo*> renamed_decls;
+  for (const DeclInfo& decl : decls_) {
+    if (decl.renamed)
+      renamed_decls.push_back(&decl);
+  }
+  std::sort(renamed_decls.begin(), renamed_decls.end(),
+            [](const DeclInfo* lhs, const DeclInfo* rhs) {
+              return lhs->usr < rhs->usr;
+            });
+  for (const DeclInfo* decl : renamed_decls) {
+    output << GetRenameCategoryTag(decl->category) << ":" << decl->old_name
+           << ":" << decl->new_name << ":" << decl->usr << "\n";
+  }
+}
+
+unsigned RenameTable::GetDeclIndex(const std::string& usr) {
+  auto result = decl_indices_.try_emplace(usr, decls_.size());
+  if (result.second) {
+    DeclInfo info;
+    info.usr = usr;
+    info.parent = decls_.size();
+    decls_.push_back(std::move(info));
+  }
+  return result.first->getValue();
+}
+
+unsigned RenameTable::FindRoot(unsigned decl_index) {
+  while (decls_[decl_index].parent != decl_index) {
+    unsigned parent = decls_[decl_index].parent;
+    decls_[decl_index].parent = decls_[parent].parent;
+    decl_index = parent;
+  }
+  return decl_index;
+}
+
+void RenameTable::Union(unsigned decl_index1, unsigned decl_index2) {
+  unsigned root1 = FindRoot(decl_index1);
+  unsigned root2 = FindRoot(decl_index2);
+  if (root1 != root2)
+    decls_[std::max(root1, root2)].parent = std::min(root1, root2);
+}
+
+void RenameTable::AddConflict(unsigned decl_index, std::string conflict) {
+  if (decls_[decl_index].conflict.empty())
+    decls_[decl_index].conflict = std::move(conflict);
+}
+
+void RenameTable::AddRename(ProposedRename rename) {
+  unsigned decl_index = kNoUSR;
+  if (!rename.usr.empty()) {
+    decl_index = GetDeclIndex(rename.usr);
+    DeclInfo& decl = decls_[decl_index];
+    if (decl.old_name.empty()) {
+      decl.old_name = rename.old_name;
+      decl.new_name = rename.new_name;
+      decl.category = rename.category;
+    } else if (decl.new_name != rename.new_name) {
+      AddConflict(decl_index, "would be renamed to both " + decl.new_name +
+                                  " and " + rename.new_name);
+    }
+  }
+
+  const clang::tooling::Replacement& replacement = rename.replacement;
+  std::string location = replacement.getFilePath().str() + ":" +
+                         std::to_string(replacement.getOffset());
+  auto result = location_edits_.try_emplace(location);
+  LocationEdit& edit = result.first->getValue();
+  if (result.second) {
+    edit.decl_index = decl_index;
+    edit.category = rename.category;
+    edit.old_name = std::move(rename.old_name);
+    edit.new_name = std::move(rename.new_name);
+    edit.tracked_filename = std::move(rename.tracked_filename);
+    edit.replacement = std::move(rename.replacement);
+    edit.has_conflict = false;
+    return;
+  }
+
+  // Edits of shared headers are proposed by every translation unit that
+  // includes them.
+  if (edit.decl_index == decl_index &&
+      edit.replacement.getLength() == replacement.getLength() &&
+      edit.replacement.getReplacementText() ==
+          replacement.getReplacementText()) {
+    return;
+  }
+
+  edit.has_conflict = true;
+  std::string conflict = "conflicting edits at " + location;
+  if (edit.decl_index != kNoUSR)
+    AddConflict(edit.decl_index, conflict);
+  if (decl_index != kNoUSR)
+    AddConflict(decl_index, conflict);
+}
@@ -0,0 +1,174 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_RENAME_TABLE_H_
+#define TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_RENAME_TABLE_H_
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EditTracker.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Tooling/Core/Replacement.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+class CXXMethodDecl;
+class NamedDecl;
+}  // namespace clang
+
+namespace llvm {
+class raw_ostream;
+}  // namespace llvm
+
+// A rename proposed by one of the rewriters for a single location.
+struct ProposedRename {
+  // USR of the renamed declaration.  Empty for renames of names that depend
+  // on template parameters (there is no declaration to refer to).
+  std::string usr;
+  RenameCategory category;
+  std::string old_name;
+  std::string new_name;
+  // File that the edit is attributed to in the tracked edits (see
+  // EditTracker).
+  std::string tracked_filename;
+  clang::tooling::Replacement replacement;
+};
+
+// Gathers the renames proposed while processing a single translation unit,
+// before they are handed over to the RenameTable.
+class TranslationUnitRenames {
+ public:
+  TranslationUnitRenames();
+  ~TranslationUnitRenames();
+
+  TranslationUnitRenames(TranslationUnitRenames&&);
+  TranslationUnitRenames& operator=(TranslationUnitRenames&&);
+
+  // Returns false if there's already a replacement for |spelling_loc| (e.g.
+  // when a function and a parameter are defined by the same macro argument).
+  bool ClaimLocation(const clang::SourceManager& source_manager,
+                     clang::SourceLocation spelling_loc);
+
+  // |decl| is the renamed declaration (null for names depending on template
+  // parameters).
+  void Add(const clang::SourceManager& source_manager,
+           clang::SourceLocation location,
+           const clang::NamedDecl* decl,
+           RenameCategory category,
+           llvm::StringRef old_name,
+           llvm::StringRef new_name,
+           clang::tooling::Replacement replacement);
+
+  // Records that |method| (and therefore also the methods it overrides and
+  // the methods overriding it) can't be renamed consistently.
+  void AddConflict(const clang::CXXMethodDecl& method);
+
+ private:
+  friend class RenameTable;
+
+  TranslationUnitRenames(const TranslationUnitRenames&) = delete;
+  TranslationUnitRenames& operator=(const TranslationUnitRenames&) = delete;
+
+  const std::string& GetUSR(const clang::NamedDecl& decl);
+  const std::string& GetTrackedFilename(
+      const clang::SourceManager& source_manager,
+      clang::SourceLocation location);
+  void AddOverriddenMethods(const clang::CXXMethodDecl& method);
+
+  std::vector<ProposedRename> renames_;
+  // (method USR, overridden method USR) pairs.
+  std::vector<std::pair<std::string, std::string>> overrides_;
+  // USRs of the methods passed to AddConflict.
+  std::vector<std::string> conflicts_;
+
+  // Caches specific to the current translation unit.
+  llvm::DenseSet<std::pair<clang::FileID, unsigned>> claimed_locations_;
+  llvm::DenseMap<const clang::Decl*, std::string> usrs_;
+  llvm::DenseMap<clang::FileID, std::string> tracked_filenames_;
+  llvm::DenseSet<const clang::CXXMethodDecl*> methods_with_overrides_;
+};
+
+// Merges the renames proposed for all the processed translation units (which
+// may be processed concurrently, e.g. with --executor=all-TUs) and detects
+// conflicts between them, so that the emitted edits are consistent across the
+// whole codebase:
+// - a declaration is renamed either everywhere or nowhere,
+// - overriding and overridden methods are renamed together,
+// - each location gets at most one replacement.
+class RenameTable {
+ public:
+  RenameTable();
+  ~RenameTable();
+
+  RenameTable(const RenameTable&) = delete;
+  RenameTable& operator=(const RenameTable&) = delete;
+
+  // Thread-safe.
+  void AddTranslationUnit(TranslationUnitRenames renames);
+
+  // Drops the renames that conflict with each other (reporting them to
+  // |errors|) and hands over the remaining ones to |replacements| and
+  // |edit_tracker|.  Returns the number of declarations that were not renamed
+  // because of conflicts.
+  size_t Resolve(llvm::raw_ostream& errors,
+                 std::set<clang::tooling::Replacement>* replacements,
+                 EditTracker* edit_tracker);
+
+  // Serializes the declarations renamed by Resolve to |output|, sorted by
+  // USR, one per line:
+  //   <tag>:<old name>:<new name>:<USR>
+  // The USR comes last since it may contain ':' itself.  Names depending on
+  // template parameters aren't bound to a declaration, so they are not listed.
+  void SerializeRenameMapTo(llvm::raw_ostream& output) const;
+
+ private:
+  static const unsigned kNoUSR = ~0u;
+
+  struct DeclInfo {
+    std::string usr;
+    std::string old_name;
+    std::string new_name;
+    RenameCategory category = RenameCategory::kUnresolved;
+    // Set by Resolve if the declaration is renamed.
+    bool renamed = false;
+    // Index of the parent in the union-find forest of declarations that need
+    // to be renamed together (i.e. overriding and overridden methods).
+    unsigned parent;
+    // Why the declaration can't be renamed (empty if it can).
+    std::string conflict;
+  };
+
+  struct LocationEdit {
+    unsigned decl_index;  // kNoUSR for names depending on template parameters.
+    RenameCategory category;
+    std::string old_name;
+    std::string new_name;
+    std::string tracked_filename;
+    clang::tooling::Replacement replacement;
+    bool has_conflict;
+  };
+
+  unsigned GetDeclIndex(const std::string& usr);
+  unsigned FindRoot(unsigned decl_index);
+  void Union(unsigned decl_index1, unsigned decl_index2);
+  void AddConflict(unsigned decl_index, std::string conflict);
+  void AddRename(ProposedRename rename);
+
+  std::mutex lock_;
+
+  llvm::StringMap<unsigned> decl_indices_;
+  std::vector<DeclInfo> decls_;
+  // Keyed by "<file path>:<offset>" of the replacement.
+  llvm::StringMap<LocationEdit> location_edits_;
+};
+
+#endif  // TOOLS_CLANG_REWRITE_TO_CHROME_STYLE_RENAME_TABLE_H_
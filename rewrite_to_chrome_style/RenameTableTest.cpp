@@ -0,0 +1,233 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Tests for RenameTable.  The renames of each translation unit are proposed by
+// hand (rather than by the rewriters), so that the translation units can
+// disagree about them, like they may when their code differs (e.g. because of
+// macros or template instantiations).
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "EditTracker.h"
+#include "RenameTable.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang::ast_matchers;
+
+namespace {
+
+const char kCode[] =
+    "namespace blink {\n"
+    "struct Base { virtual void doTheWork(); int m_count; };\n"
+    "struct Renamed : Base { void doTheWork() override; };\n"
+    "struct Blocked : Base { void doTheWork() override; };\n"
+    "template <typename T> struct Wrapper { void doTheWork(); T m_value; };\n"
+    "Wrapper<int> g_intWrapper;\n"
+    "Wrapper<char> g_charWrapper;\n"
+    "}  // namespace blink\n";
+
+int g_failures = 0;
+
+#define EXPECT_TRUE(condition)                                            \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      llvm::errs() << __FILE__ << ":" << __LINE__ << ": " << current_test \
+                   << ": expected " #condition "\n";                      \
+      g_failures++;                                                       \
+    }                                                                     \
+  } while (false)
+
+// A translation unit proposing renames of the declarations in kCode.
+class TestTranslationUnit {
+ public:
+  TestTranslationUnit()
+      : ast_unit_(clang::tooling::buildASTFromCodeWithArgs(
+            kCode,
+            {"-std=c++14"},
+            "test.cc")) {}
+
+  const clang::NamedDecl* FindDecl(const std::string& qualified_name) {
+    return selectFirst<clang::NamedDecl>(
+        "decl", match(namedDecl(hasName(qualified_name)).bind("decl"),
+                      ast_unit_->getASTContext()));
+  }
+
+  // Returns the member called |member_name| of the type of |variable_name|
+  // (e.g. of a class template specialization).
+  const clang::NamedDecl* FindMember(const std::string& variable_name,
+                                     const std::string& member_name) {
+    const auto* variable = clang::cast<clang::VarDecl>(FindDecl(variable_name));
+    const clang::CXXRecordDecl* record =
+        variable->getType()->getAsCXXRecordDecl();
+    return record->lookup(&ast_unit_->getASTContext().Idents.get(member_name))
+        .front();
+  }
+
+  void AddRename(const std::string& qualified_name,
+                 RenameCategory category,
+                 const std::string& new_name) {
+    AddRename(FindDecl(qualified_name), category, new_name);
+  }
+
+  void AddRename(const clang::NamedDecl* decl,
+                 RenameCategory category,
+                 const std::string& new_name) {
+    const clang::SourceManager& source_manager =
+        ast_unit_->getSourceManager();
+    clang::tooling::Replacement replacement(
+        source_manager,
+        clang::CharSourceRange::getTokenRange(decl->getLocation()), new_name);
+    renames_.Add(source_manager, decl->getLocation(), decl, category,
+                 decl->getName(), new_name, std::move(replacement));
+  }
+
+  void AddConflict(const std::string& qualified_name) {
+    renames_.AddConflict(
+        *clang::cast<clang::CXXMethodDecl>(FindDecl(qualified_name)));
+  }
+
+  void AddTo(RenameTable* rename_table) {
+    rename_table->AddTranslationUnit(std::move(renames_));
+  }
+
+ private:
+  std::unique_ptr<clang::ASTUnit> ast_unit_;
+  TranslationUnitRenames renames_;
+};
+
+struct ResolveResult {
+  size_t blocked_decls;
+  std::string errors;
+  std::set<clang::tooling::Replacement> replacements;
+  std::string rename_map;
+};
+
+ResolveResult Resolve(RenameTable* rename_table) {
+  ResolveResult result;
+  llvm::raw_string_ostream errors(result.errors);
+  EditTracker edit_tracker;
+  result.blocked_decls =
+      rename_table->Resolve(errors, &result.replacements, &edit_tracker);
+  errors.flush();
+  llvm::raw_string_ostream rename_map(result.rename_map);
+  rename_table->SerializeRenameMapTo(rename_map);
+  rename_map.flush();
+  return result;
+}
+
+void TestAgreeingTranslationUnits() {
+  const char current_test[] = "TestAgreeingTranslationUnits";
+  RenameTable rename_table;
+  for (int i = 0; i < 2; i++) {
+    TestTranslationUnit tu;
+    tu.AddRename("blink::Base::m_count", RenameCategory::kField, "count_");
+    tu.AddTo(&rename_table);
+  }
+
+  ResolveResult result = Resolve(&rename_table);
+  EXPECT_TRUE(result.blocked_decls == 0);
+  EXPECT_TRUE(result.errors.empty());
+  // Edits of shared code are proposed by both translation units, but only
+  // emitted once.
+  EXPECT_TRUE(result.replacements.size() == 1);
+  EXPECT_TRUE(result.rename_map.find("var:m_count:count_:") == 0);
+}
+
+void TestDisagreeingTranslationUnits() {
+  const char current_test[] = "TestDisagreeingTranslationUnits";
+  RenameTable rename_table;
+  TestTranslationUnit tu1;
+  tu1.AddRename("blink::Base::m_count", RenameCategory::kField, "count_");
+  tu1.AddTo(&rename_table);
+  TestTranslationUnit tu2;
+  tu2.AddRename("blink::Base::m_count", RenameCategory::kField, "count");
+  tu2.AddTo(&rename_table);
+
+  ResolveResult result = Resolve(&rename_table);
+  EXPECT_TRUE(result.blocked_decls == 1);
+  EXPECT_TRUE(result.errors.find("Not renaming m_count") != std::string::npos);
+  EXPECT_TRUE(result.errors.find("would be renamed to both count_ and count") !=
+              std::string::npos);
+  EXPECT_TRUE(result.replacements.empty());
+  EXPECT_TRUE(result.rename_map.empty());
+}
+
+void TestOverrideConflictInAnotherTranslationUnit() {
+  const char current_test[] = "TestOverrideConflictInAnotherTranslationUnit";
+  RenameTable rename_table;
+  TestTranslationUnit tu1;
+  tu1.AddRename("blink::Base::doTheWork", RenameCategory::kFunction,
+                "DoTheWork");
+  tu1.AddRename("blink::Renamed::doTheWork", RenameCategory::kFunction,
+                "DoTheWork");
+  tu1.AddRename("blink::Base::m_count", RenameCategory::kField, "count_");
+  tu1.AddTo(&rename_table);
+  // Blocked::doTheWork is only connected to Renamed::doTheWork through
+  // Base::doTheWork, which it overrides.
+  TestTranslationUnit tu2;
+  tu2.AddConflict("blink::Blocked::doTheWork");
+  tu2.AddTo(&rename_table);
+
+  ResolveResult result = Resolve(&rename_table);
+  EXPECT_TRUE(result.blocked_decls == 2);
+  EXPECT_TRUE(result.errors.find("overrides some methods that would be "
+                                 "renamed and some that wouldn't") !=
+              std::string::npos);
+  // Only the unrelated field is renamed.
+  EXPECT_TRUE(result.replacements.size() == 1);
+  EXPECT_TRUE(result.rename_map.find("var:m_count:count_:") == 0);
+  EXPECT_TRUE(result.rename_map.find("doTheWork") == std::string::npos);
+}
+
+void TestMembersOfClassTemplateSpecializations() {
+  const char current_test[] = "TestMembersOfClassTemplateSpecializations";
+  RenameTable rename_table;
+  TestTranslationUnit tu1;
+  tu1.AddRename(tu1.FindMember("blink::g_intWrapper", "doTheWork"),
+                RenameCategory::kFunction, "DoTheWork");
+  tu1.AddRename(tu1.FindMember("blink::g_intWrapper", "m_value"),
+                RenameCategory::kField, "value_");
+  tu1.AddTo(&rename_table);
+  // The members of the specializations are the same declarations as the
+  // members of the template.
+  TestTranslationUnit tu2;
+  tu2.AddRename("blink::Wrapper::doTheWork", RenameCategory::kFunction,
+                "DoTheWork");
+  tu2.AddRename(tu2.FindMember("blink::g_charWrapper", "m_value"),
+                RenameCategory::kField, "value");
+  tu2.AddTo(&rename_table);
+
+  ResolveResult result = Resolve(&rename_table);
+  EXPECT_TRUE(result.blocked_decls == 1);
+  EXPECT_TRUE(result.errors.find("would be renamed to both value_ and "
+                                 "value") != std::string::npos);
+  EXPECT_TRUE(result.replacements.size() == 1);
+  EXPECT_TRUE(result.rename_map.find("func:doTheWork:DoTheWork:") == 0);
+  EXPECT_TRUE(result.rename_map.find("m_value") == std::string::npos);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  TestAgreeingTranslationUnits();
+  TestDisagreeingTranslationUnits();
+  TestOverrideConflictInAnotherTranslationUnit();
+  TestMembersOfClassTemplateSpecializations();
+
+  if (g_failures) {
+    llvm::errs() << g_failures << " expectation(s) failed\n";
+    return 1;
+  }
+  llvm::outs() << "All RenameTable tests passed\n";
+  return 0;
+}
@@ -11,12 +11,22 @@
 //     const int maxThings => const int kMaxThings
 //   free functions and methods:
 //     void doThisThenThat() => void DoThisAndThat()
+//
+// Additional renames can be described by the rules in a --naming-rules file
+// (see NamingRules.h), which are applied in the same pass.
+//
+// Translation units may be processed concurrently, e.g. with
+// --executor=all-TUs --execute-concurrency=N.  The renames proposed for each
+// translation unit are merged in a RenameTable, which only emits the renames
+// that are consistent across all of them.
 
 #include <assert.h>
 #include <algorithm>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
@@ -31,16 +41,25 @@
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Tooling/Execution.h"
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "EditTracker.h"
+#include "NamingRules.h"
+#include "RenameTable.h"
+#include "common/EditWriter.h"
 
 using namespace clang::ast_matchers;
 using clang::tooling::CommonOptionsParser;
@@ -54,11 +73,6 @@ const char kBlinkStaticMemberPrefix[] = "s_";
 const char kGMockMethodNamePrefix[] = "gmock_";
 const char kMethodBlocklistParamName[] = "method-blocklist";
 
-std::set<clang::SourceLocation>& GetRewrittenLocs() {
-  static auto& locations = *new std::set<clang::SourceLocation>();
-  return locations;
-}
-
 template <typename MatcherType, typename NodeType>
 bool IsMatching(const MatcherType& matcher,
                 const NodeType& node,
@@ -140,11 +154,9 @@ class MethodBlocklist {
   }
 
   bool Contains(const clang::FunctionDecl& method) const {
-    if (!method.getDeclName().isIdentifier())
+    if (entries_.empty())
       return false;
-
-    auto it = method_to_classes_.find(method.getName());
-    if (it == method_to_classes_.end())
+    if (!method.getDeclName().isIdentifier())
       return false;
 
     // |method_context| is either
@@ -157,24 +169,42 @@ class MethodBlocklist {
     if (!method_context->getDeclName().isIdentifier())
       return false;
 
-    const llvm::StringSet<>& classes = it->second;
-    auto it2 = classes.find(method_context->getName());
-    if (it2 == classes.end())
+    llvm::SmallString<128> key;
+    auto it = entries_.find(GetKey(method_context->getName(), method.getName(),
+                                   method.getNumParams(), &key));
+    if (it == entries_.end())
       return false;
 
-    // No need to verify here that |actual_class| is in the |blink| namespace -
-    // this will be done by other matchers elsewhere.
+    // Unqualified entries match the context in any namespace (verifying that
+    // the context is in the |blink| namespace is done by other matchers
+    // elsewhere).
+    const std::string& qualified_context_name = it->getValue();
+    if (!qualified_context_name.empty() &&
+        qualified_context_name != method_context->getQualifiedNameAsString()) {
+      return false;
+    }
 
     // TODO(lukasza): Do we need to consider return type and/or param types?
 
-    // TODO(lukasza): Do we need to consider param count?
-
     return true;
   }
 
  private:
+  // A single string made of all the parts of an entry (stored in |key|), so
+  // that looking a method up takes a single probe.
+  static llvm::StringRef GetKey(llvm::StringRef context_name,
+                                llvm::StringRef method_name,
+                                unsigned number_of_params,
+                                llvm::SmallVectorImpl<char>* key) {
+    return (context_name + ":::" + method_name + ":::" +
+            llvm::Twine(number_of_params))
+        .toStringRef(*key);
+  }
+
   // Each line is expected to have the following format:
   // <class name>:::<method name>:::<number of arguments>
+  // where <class name> can be qualified with namespaces (e.g.
+  // blink::Document) to match only the class in the given namespace.
   void ParseInputFile(const std::string& filepath) {
     llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file_or_err =
         llvm::MemoryBuffer::getFile(filepath);
@@ -196,50 +226,167 @@ class MethodBlocklist {
       const size_t kExpectedNumberOfParts = 3;
       llvm::SmallVector<llvm::StringRef, kExpectedNumberOfParts> parts;
       line.split(parts, ":::");
-      if (parts.size() != kExpectedNumberOfParts) {
+      unsigned number_of_params;
+      if (parts.size() != kExpectedNumberOfParts ||
+          parts[2].trim().getAsInteger(10, number_of_params)) {
         llvm::errs() << "ERROR: Parsing error - expected "
                      << kExpectedNumberOfParts
-                     << " ':::'-delimited parts: " << filepath << ":"
-                     << it.line_number() << ": " << line << "\n";
+                     << " ':::'-delimited parts (the last one being a number): "
+                     << filepath << ":" << it.line_number() << ": " << line
+                     << "\n";
         assert(false);
         continue;
       }
 
       // Parse individual parts.
-      llvm::StringRef class_name = parts[0];
+      llvm::StringRef qualified_context_name = parts[0];
+      llvm::StringRef context_name = qualified_context_name;
+      size_t last_separator = qualified_context_name.rfind("::");
+      if (last_separator == llvm::StringRef::npos)
+        qualified_context_name = llvm::StringRef();
+      else
+        context_name = qualified_context_name.substr(last_separator + 2);
       llvm::StringRef method_name = parts[1];
-      // ignoring parts[2] - the (not so trustworthy) number of parameters.
 
       // Store the new entry.
-      method_to_classes_[method_name].insert(class_name);
+      llvm::SmallString<128> key;
+      auto result = entries_.try_emplace(
+          GetKey(context_name, method_name, number_of_params, &key),
+          qualified_context_name.str());
+      std::string& existing_qualified_context_name = result.first->getValue();
+      if (!result.second &&
+          existing_qualified_context_name != qualified_context_name) {
+        // The same class and method are listed both with and without
+        // namespaces (or in different namespaces) - block them in any
+        // namespace.
+        existing_qualified_context_name.clear();
+      }
     }
   }
 
-  // Stores methods to blacklist in a map:
-  // method name -> class name -> set of all allowed numbers of arguments.
-  llvm::StringMap<llvm::StringSet<>> method_to_classes_;
+  // Stores methods to blocklist, keyed by GetKey.  The values are the
+  // namespace-qualified context names (empty if the context name was not
+  // qualified with a namespace).
+  llvm::StringMap<std::string> entries_;
 };
 
 AST_MATCHER_P(clang::FunctionDecl,
               isBlocklistedMethod,
-              MethodBlocklist,
+              const MethodBlocklist*,
               Blocklist) {
-  return Blocklist.Contains(Node);
+  return Blocklist->Contains(Node);
 }
 
-// If |InnerMatcher| matches |top|, then the returned matcher will match:
-// - |top::function|
-// - |top::Class::method|
-// - |top::internal::Class::method|
-AST_MATCHER_P(
-    clang::NestedNameSpecifier,
-    hasTopLevelPrefix,
-    clang::ast_matchers::internal::Matcher<clang::NestedNameSpecifier>,
-    InnerMatcher) {
-  const clang::NestedNameSpecifier* NodeToMatch = &Node;
-  while (NodeToMatch->getPrefix())
-    NodeToMatch = NodeToMatch->getPrefix();
-  return InnerMatcher.matches(*NodeToMatch, Finder, Builder);
+// Tells whether decls are in the blink / WTF namespaces.  Each lexical
+// DeclContext is classified once (and the verdict is cached), which is much
+// cheaper than matching with hasAncestor - hasAncestor needs the parent map of
+// the whole ASTContext and walks all the way up the AST for every candidate
+// node.  DeclContexts are specific to a translation unit, so an index can only
+// be used for a single translation unit.
+class BlinkDeclContextIndex {
+ public:
+  BlinkDeclContextIndex() = default;
+
+  // Returns true if |decl|
+  // - is nested in the blink or WTF namespace (but not in blink::protocol):
+  //     namespace WTF {
+  //       void foo() {}
+  //     }
+  // - or is (or is nested in) a declaration qualified with the blink or WTF
+  //   namespace:
+  //     void WTF::function() {}
+  //     void WTF::Class::method() {}
+  bool IsInBlinkNamespace(const clang::Decl& decl) {
+    if (HasBlinkQualifier(decl))
+      return true;
+
+    const clang::DeclContext* context = decl.getLexicalDeclContext();
+    if (!context)
+      return false;
+    unsigned flags = GetFlags(context);
+    if (flags & kHasBlinkQualifier)
+      return true;
+    return (flags & kInBlinkNamespace) && !(flags & kInProtocolNamespace);
+  }
+
+ private:
+  BlinkDeclContextIndex(const BlinkDeclContextIndex&) = delete;
+  BlinkDeclContextIndex& operator=(const BlinkDeclContextIndex&) = delete;
+
+  // Bits describing a DeclContext (including all of its lexical parents).
+  enum Flags : unsigned {
+    kInBlinkNamespace = 1 << 0,
+    kInProtocolNamespace = 1 << 1,
+    kHasBlinkQualifier = 1 << 2,
+  };
+
+  // Matches the top-level blink and WTF namespaces.
+  static bool IsBlinkNamespace(const clang::NamespaceDecl& decl) {
+    return (decl.getName() == "blink" || decl.getName() == "WTF") &&
+           decl.getDeclContext()->isTranslationUnit();
+  }
+
+  // Matches the blink::protocol namespace.
+  static bool IsProtocolNamespace(const clang::NamespaceDecl& decl) {
+    if (decl.getName() != "protocol")
+      return false;
+    auto* parent = clang::dyn_cast<clang::NamespaceDecl>(decl.getDeclContext());
+    return parent && parent->getName() == "blink" &&
+           parent->getDeclContext()->isTranslationUnit();
+  }
+
+  // Returns true if the top-level prefix of the qualifier of |decl| is the
+  // blink or WTF namespace, which matches:
+  // - |blink::function|
+  // - |blink::Class::method|
+  // - |blink::internal::Class::method|
+  static bool HasBlinkQualifier(const clang::Decl& decl) {
+    auto* declarator_decl = clang::dyn_cast<clang::DeclaratorDecl>(&decl);
+    if (!declarator_decl)
+      return false;
+
+    const clang::NestedNameSpecifier* qualifier =
+        declarator_decl->getQualifier();
+    if (!qualifier)
+      return false;
+    while (qualifier->getPrefix())
+      qualifier = qualifier->getPrefix();
+    const clang::NamespaceDecl* namespace_decl = qualifier->getAsNamespace();
+    return namespace_decl && IsBlinkNamespace(*namespace_decl);
+  }
+
+  unsigned GetFlags(const clang::DeclContext* context) {
+    if (context->isTranslationUnit())
+      return 0;
+
+    auto it = flags_.find(context);
+    if (it != flags_.end())
+      return it->second;
+
+    unsigned flags = 0;
+    if (const clang::DeclContext* parent = context->getLexicalParent())
+      flags = GetFlags(parent);
+    if (auto* namespace_decl = clang::dyn_cast<clang::NamespaceDecl>(context)) {
+      if (IsBlinkNamespace(*namespace_decl))
+        flags |= kInBlinkNamespace;
+      if (IsProtocolNamespace(*namespace_decl))
+        flags |= kInProtocolNamespace;
+    } else if (HasBlinkQualifier(*clang::Decl::castFromDeclContext(context))) {
+      flags |= kHasBlinkQualifier;
+    }
+
+    flags_.try_emplace(context, flags);
+    return flags;
+  }
+
+  llvm::DenseMap<const clang::DeclContext*, unsigned> flags_;
+};
+
+AST_MATCHER_P(clang::Decl,
+              isInBlinkNamespace,
+              BlinkDeclContextIndex*,
+              Index) {
+  return Index->IsInBlinkNamespace(Node);
 }
 
 // This will narrow CXXCtorInitializers down for both FieldDecls and
@@ -276,10 +423,34 @@ void PrintForDiagnostics(clang::raw_ostream& os,
   decl.getNameForDiagnostic(os, decl.getASTContext().getPrintingPolicy(), true);
 }
 
+// Verdicts of includeAllOverriddenMethods for the methods of the current
+// translation unit.  Deep class hierarchies share most of their overridden
+// methods, so without the cache the same methods would be matched again for
+// every override.  Note that the cached verdicts are specific to a single inner
+// matcher (which mustn't bind any nodes).
+struct OverriddenMethodsVerdicts {
+  explicit OverriddenMethodsVerdicts(TranslationUnitRenames* renames)
+      : renames(renames) {}
+
+  llvm::DenseMap<const clang::CXXMethodDecl*, bool> verdicts;
+  // Receives the methods that can't be renamed consistently with all the
+  // methods they override.
+  TranslationUnitRenames* const renames;
+};
+
 template <typename T>
 bool MatchAllOverriddenMethods(
     const clang::CXXMethodDecl& decl,
     T&& inner_matcher,
+    OverriddenMethodsVerdicts* verdicts,
+    clang::ast_matchers::internal::ASTMatchFinder* finder,
+    clang::ast_matchers::internal::BoundNodesTreeBuilder* builder);
+
+template <typename T>
+bool MatchAllOverriddenMethodsUncached(
+    const clang::CXXMethodDecl& decl,
+    T&& inner_matcher,
+    OverriddenMethodsVerdicts* verdicts,
     clang::ast_matchers::internal::ASTMatchFinder* finder,
     clang::ast_matchers::internal::BoundNodesTreeBuilder* builder) {
   bool override_matches = false;
@@ -287,7 +458,8 @@ bool MatchAllOverriddenMethods(
 
   for (auto it = decl.begin_overridden_methods();
        it != decl.end_overridden_methods(); ++it) {
-    if (MatchAllOverriddenMethods(**it, inner_matcher, finder, builder))
+    if (MatchAllOverriddenMethods(**it, inner_matcher, verdicts, finder,
+                                  builder))
       override_matches = true;
     else
       override_not_matches = true;
@@ -297,9 +469,10 @@ bool MatchAllOverriddenMethods(
   // method that does not match the inner matcher. In that case we will match
   // one ancestor method but not the other. If we rename one of the and not the
   // other it will break what this class overrides, disconnecting it from the
-  // one we did not rename which creates a behaviour change. So assert and
-  // demand the user to fix the code first (or add the method to our
-  // blacklist T_T).
+  // one we did not rename which creates a behaviour change. So report the
+  // conflict to the RenameTable, which then doesn't rename any of the methods
+  // overriding or overridden by this one, in any translation unit (the user
+  // can fix the code first or add the method to our blacklist T_T).
   if (override_matches && override_not_matches) {
     // blink::InternalSettings::trace method overrides
     // 1) blink::InternalSettingsGenerated::trace
@@ -321,10 +494,10 @@ bool MatchAllOverriddenMethods(
     if (IsMatching(is_method_safe_to_rename, decl, decl.getASTContext()))
       return true;
 
-    // For previously unknown conflicts, error out and require a human to
-    // analyse the problem (rather than falling back to a potentially unsafe /
-    // code semantics changing rename).
-    llvm::errs() << "ERROR: ";
+    // For previously unknown conflicts, require a human to analyse the problem
+    // (rather than falling back to a potentially unsafe / code semantics
+    // changing rename).
+    llvm::errs() << "WARNING: ";
     PrintForDiagnostics(llvm::errs(), decl);
     llvm::errs() << " method overrides "
                  << "some virtual methods that will be automatically renamed "
@@ -332,7 +505,8 @@ bool MatchAllOverriddenMethods(
     llvm::errs() << "\n";
     for (auto it = decl.begin_overridden_methods();
          it != decl.end_overridden_methods(); ++it) {
-      if (MatchAllOverriddenMethods(**it, inner_matcher, finder, builder))
+      if (MatchAllOverriddenMethods(**it, inner_matcher, verdicts, finder,
+                                    builder))
         llvm::errs() << "Overriden method that will be renamed: ";
       else
         llvm::errs() << "Overriden method that will not be renamed: ";
@@ -340,7 +514,7 @@ bool MatchAllOverriddenMethods(
       llvm::errs() << "\n";
     }
     llvm::errs() << "\n";
-    assert(false);
+    verdicts->renames->AddConflict(decl);
   }
 
   // If the method overrides something that doesn't match, so the method itself
@@ -356,11 +530,31 @@ bool MatchAllOverriddenMethods(
   return inner_matcher.matches(decl, finder, builder);
 }
 
-AST_MATCHER_P(clang::CXXMethodDecl,
-              includeAllOverriddenMethods,
-              clang::ast_matchers::internal::Matcher<clang::CXXMethodDecl>,
-              InnerMatcher) {
-  return MatchAllOverriddenMethods(Node, InnerMatcher, Finder, Builder);
+template <typename T>
+bool MatchAllOverriddenMethods(
+    const clang::CXXMethodDecl& decl,
+    T&& inner_matcher,
+    OverriddenMethodsVerdicts* verdicts,
+    clang::ast_matchers::internal::ASTMatchFinder* finder,
+    clang::ast_matchers::internal::BoundNodesTreeBuilder* builder) {
+  auto it = verdicts->verdicts.find(&decl);
+  if (it != verdicts->verdicts.end())
+    return it->second;
+
+  bool verdict = MatchAllOverriddenMethodsUncached(decl, inner_matcher,
+                                                   verdicts, finder, builder);
+  verdicts->verdicts.try_emplace(&decl, verdict);
+  return verdict;
+}
+
+AST_MATCHER_P2(clang::CXXMethodDecl,
+               includeAllOverriddenMethods,
+               clang::ast_matchers::internal::Matcher<clang::CXXMethodDecl>,
+               InnerMatcher,
+               OverriddenMethodsVerdicts*,
+               Verdicts) {
+  return MatchAllOverriddenMethods(Node, InnerMatcher, Verdicts, Finder,
+                                   Builder);
 }
 
 // Matches |T::m| and/or |x->T::m| and/or |x->m| CXXDependentScopeMemberExpr
@@ -537,44 +731,21 @@ AST_MATCHER(clang::Decl, isDeclInGeneratedFile) {
   return is_generated_file && !is_computed_style_base_cpp;
 }
 
-// Helper to convert from a camelCaseName to camel_case_name. It uses some
-// heuristics to try to handle acronyms in camel case names correctly.
-std::string CamelCaseToUnderscoreCase(StringRef input) {
-  std::string output;
-  bool needs_underscore = false;
-  bool was_lowercase = false;
-  bool was_uppercase = false;
-  bool first_char = true;
-  // Iterate in reverse to minimize the amount of backtracking.
-  for (const unsigned char* i = input.bytes_end() - 1; i >= input.bytes_begin();
-       --i) {
-    char c = *i;
-    bool is_lowercase = clang::isLowercase(c);
-    bool is_uppercase = clang::isUppercase(c);
-    c = clang::toLowercase(c);
-    // Transitioning from upper to lower case requires an underscore. This is
-    // needed to handle names with acronyms, e.g. handledHTTPRequest needs a '_'
-    // in 'dH'. This is a complement to the non-acronym case further down.
-    if (was_uppercase && is_lowercase)
-      needs_underscore = true;
-    if (needs_underscore) {
-      output += '_';
-      needs_underscore = false;
-    }
-    output += c;
-    // Handles the non-acronym case: transitioning from lower to upper case
-    // requires an underscore when emitting the next character, e.g. didLoad
-    // needs a '_' in 'dL'.
-    if (!first_char && was_lowercase && is_uppercase)
-      needs_underscore = true;
-    was_lowercase = is_lowercase;
-    was_uppercase = is_uppercase;
-    first_char = false;
-  }
-  std::reverse(output.begin(), output.end());
-  return output;
+// Results of CanBeEvaluatedAtCompileTime for the statements of the current
+// translation unit.  Without the cache, the checks below would be repeated for
+// every enclosing expression and every use of a variable (e.g. for chains of
+// constants initialized from other constants).  Translation units may be
+// processed concurrently (see RenameAction), so each thread has its own cache,
+// cleared by RenameAction::BeginSourceFileAction.
+using CompileTimeEvaluationCache = llvm::DenseMap<const clang::Stmt*, bool>;
+CompileTimeEvaluationCache& GetCompileTimeEvaluationCache() {
+  thread_local CompileTimeEvaluationCache cache;
+  return cache;
 }
 
+bool CanBeEvaluatedAtCompileTimeUncached(const clang::Expr* expr,
+                                         const clang::ASTContext& context);
+
 bool CanBeEvaluatedAtCompileTime(const clang::Stmt* stmt,
                                  const clang::ASTContext& context) {
   auto* expr = clang::dyn_cast<clang::Expr>(stmt);
@@ -583,6 +754,21 @@ bool CanBeEvaluatedAtCompileTime(const clang::Stmt* stmt,
     return true;
   }
 
+  CompileTimeEvaluationCache& cache = GetCompileTimeEvaluationCache();
+  auto it = cache.find(expr);
+  if (it != cache.end())
+    return it->second;
+
+  // Start with |false| in case a variable's initializer (indirectly) refers
+  // to the variable itself.
+  cache[expr] = false;
+  bool result = CanBeEvaluatedAtCompileTimeUncached(expr, context);
+  cache[expr] = result;
+  return result;
+}
+
+bool CanBeEvaluatedAtCompileTimeUncached(const clang::Expr* expr,
+                                         const clang::ASTContext& context) {
   // Function calls create non-consistent behaviour. For some template
   // instantiations they can be constexpr while for others they are not, which
   // changes the output of isEvaluatable().
@@ -797,7 +983,13 @@ AST_MATCHER(clang::FunctionDecl, shouldPrefixFunctionName) {
 
 bool GetNameForDecl(const clang::FunctionDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
+  if (naming_rules.GetNewName(NamingRules::Kind::kFunction, decl.getName(),
+                              &name)) {
+    return true;
+  }
+
   name = decl.getName().str();
   name[0] = clang::toUppercase(name[0]);
 
@@ -844,8 +1036,13 @@ bool GetNameForDecl(const clang::FunctionDecl& decl,
 
 bool GetNameForDecl(const clang::EnumConstantDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   StringRef original_name = decl.getName();
+  if (naming_rules.GetNewName(NamingRules::Kind::kEnumValue, original_name,
+                              &name)) {
+    return true;
+  }
 
   // If it's already correct leave it alone.
   if (original_name.size() >= 2 && original_name[0] == 'k' &&
@@ -871,8 +1068,12 @@ bool GetNameForDecl(const clang::EnumConstantDecl& decl,
 
 bool GetNameForDecl(const clang::FieldDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   StringRef original_name = decl.getName();
+  if (naming_rules.GetNewName(NamingRules::Kind::kField, original_name, &name))
+    return true;
+
   bool member_prefix = original_name.startswith(kBlinkFieldPrefix);
 
   StringRef rename_part = !member_prefix
@@ -890,6 +1091,7 @@ bool GetNameForDecl(const clang::FieldDecl& decl,
 
 bool GetNameForDecl(const clang::VarDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   StringRef original_name = decl.getName();
 
@@ -897,6 +1099,15 @@ bool GetNameForDecl(const clang::VarDecl& decl,
   if (clang::isa<clang::ParmVarDecl>(decl) && original_name.empty())
     return false;
 
+  if (naming_rules.HasRules(NamingRules::Kind::kVariable) ||
+      naming_rules.HasRules(NamingRules::Kind::kConstant)) {
+    NamingRules::Kind kind = IsProbablyConst(decl, context)
+                                 ? NamingRules::Kind::kConstant
+                                 : NamingRules::Kind::kVariable;
+    if (naming_rules.GetNewName(kind, original_name, &name))
+      return true;
+  }
+
   // This is a type trait that appears in consumers of WTF as well as inside
   // WTF. We want it to be named in this_style_of_case accordingly.
   if (IsKnownTraitName(original_name)) {
@@ -950,31 +1161,34 @@ bool GetNameForDecl(const clang::VarDecl& decl,
 
 bool GetNameForDecl(const clang::FunctionTemplateDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   clang::FunctionDecl* templated_function = decl.getTemplatedDecl();
-  return GetNameForDecl(*templated_function, context, name);
+  return GetNameForDecl(*templated_function, context, naming_rules, name);
 }
 
 bool GetNameForDecl(const clang::NamedDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   if (auto* function = clang::dyn_cast<clang::FunctionDecl>(&decl))
-    return GetNameForDecl(*function, context, name);
+    return GetNameForDecl(*function, context, naming_rules, name);
   if (auto* var = clang::dyn_cast<clang::VarDecl>(&decl))
-    return GetNameForDecl(*var, context, name);
+    return GetNameForDecl(*var, context, naming_rules, name);
   if (auto* field = clang::dyn_cast<clang::FieldDecl>(&decl))
-    return GetNameForDecl(*field, context, name);
+    return GetNameForDecl(*field, context, naming_rules, name);
   if (auto* function_template =
           clang::dyn_cast<clang::FunctionTemplateDecl>(&decl))
-    return GetNameForDecl(*function_template, context, name);
+    return GetNameForDecl(*function_template, context, naming_rules, name);
   if (auto* enumc = clang::dyn_cast<clang::EnumConstantDecl>(&decl))
-    return GetNameForDecl(*enumc, context, name);
+    return GetNameForDecl(*enumc, context, naming_rules, name);
 
   return false;
 }
 
 bool GetNameForDecl(const clang::UsingDecl& decl,
                     clang::ASTContext& context,
+                    const NamingRules& naming_rules,
                     std::string& name) {
   assert(decl.shadow_size() > 0);
 
@@ -982,7 +1196,8 @@ bool GetNameForDecl(const clang::UsingDecl& decl,
   // functions, it can introduce multiple shadowed declarations. Just using the
   // first one is OK, since overloaded functions have the same name, by
   // definition.
-  return GetNameForDecl(*decl.shadow_begin()->getTargetDecl(), context, name);
+  return GetNameForDecl(*decl.shadow_begin()->getTargetDecl(), context,
+                        naming_rules, name);
 }
 
 template <typename Type>
@@ -1074,9 +1289,12 @@ struct TargetNodeTraits<clang::UnresolvedUsingValueDecl> {
 template <typename TargetNode>
 class RewriterBase : public MatchFinder::MatchCallback {
  public:
-  explicit RewriterBase(std::set<Replacement>* replacements,
-                        RenameCategory category)
-      : replacements_(replacements), edit_tracker_(category) {}
+  RewriterBase(TranslationUnitRenames* renames,
+               const NamingRules* naming_rules,
+               RenameCategory category)
+      : renames_(renames), naming_rules_(naming_rules), category_(category) {}
+
+  const NamingRules& naming_rules() const { return *naming_rules_; }
 
   const TargetNode& GetTargetNode(const MatchFinder::MatchResult& result) {
     const TargetNode* target_node = result.Nodes.getNodeAs<TargetNode>(
@@ -1139,7 +1357,7 @@ class RewriterBase : public MatchFinder::MatchCallback {
       // other replacements to avoid potential naming conflicts. This is
       // primarily to avoid problems when a function and a parameter are defined
       // by the same macro argument.
-      if (!GetRewrittenLocs().emplace(spell).second)
+      if (!renames_->ClaimLocation(source_manager, spell))
         return false;
 
       *replacement = Replacement(source_manager, range, new_text);
@@ -1152,6 +1370,13 @@ class RewriterBase : public MatchFinder::MatchCallback {
     return TargetNodeTraits<TargetNode>::GetLoc(GetTargetNode(result));
   }
 
+  // Returns the declaration renamed by the replacement (or null if the renamed
+  // name depends on template parameters and there's no declaration).
+  virtual const clang::NamedDecl* GetRenamedDecl(
+      const MatchFinder::MatchResult& result) {
+    return nullptr;
+  }
+
   void AddReplacement(const MatchFinder::MatchResult& result,
                       llvm::StringRef old_name,
                       std::string new_name) {
@@ -1166,15 +1391,14 @@ class RewriterBase : public MatchFinder::MatchCallback {
     if (!GenerateReplacement(result, loc, old_name, new_name, &replacement))
       return;
 
-    replacements_->insert(std::move(replacement));
-    edit_tracker_.Add(*result.SourceManager, loc, old_name, new_name);
+    renames_->Add(*result.SourceManager, loc, GetRenamedDecl(result),
+                  category_, old_name, new_name, std::move(replacement));
   }
 
-  const EditTracker* edit_tracker() const { return &edit_tracker_; }
-
  private:
-  std::set<Replacement>* const replacements_;
-  EditTracker edit_tracker_;
+  TranslationUnitRenames* const renames_;
+  const NamingRules* const naming_rules_;
+  const RenameCategory category_;
 };
 
 template <typename DeclNode>
@@ -1213,8 +1437,14 @@ class DeclRewriterBase : public RewriterBase<TargetNode> {
  public:
   using Base = RewriterBase<TargetNode>;
 
-  explicit DeclRewriterBase(std::set<Replacement>* replacements)
-      : Base(replacements, GetCategory<DeclNode>()) {}
+  DeclRewriterBase(TranslationUnitRenames* renames,
+                   const NamingRules* naming_rules)
+      : Base(renames, naming_rules, GetCategory<DeclNode>()) {}
+
+  const clang::NamedDecl* GetRenamedDecl(
+      const MatchFinder::MatchResult& result) override {
+    return result.Nodes.getNodeAs<DeclNode>("decl");
+  }
 
   void run(const MatchFinder::MatchResult& result) override {
     const DeclNode* decl = result.Nodes.getNodeAs<DeclNode>("decl");
@@ -1230,7 +1460,8 @@ class DeclRewriterBase : public RewriterBase<TargetNode> {
 
     // Get the new name.
     std::string new_name;
-    if (!GetNameForDecl(*decl, *result.Context, new_name))
+    if (!GetNameForDecl(*decl, *result.Context, Base::naming_rules(),
+                        new_name))
       return;  // If false, the name was not suitable for renaming.
 
     // Check if we are able to rewrite the decl (to avoid rewriting if the
@@ -1282,11 +1513,14 @@ class GMockMemberRewriter
  public:
   using Base = DeclRewriterBase<clang::CXXMethodDecl, clang::MemberExpr>;
 
-  explicit GMockMemberRewriter(std::set<Replacement>* replacements)
-      : Base(replacements) {}
+  GMockMemberRewriter(TranslationUnitRenames* renames,
+                      const NamingRules* naming_rules)
+      : Base(renames, naming_rules) {}
 
-  std::unique_ptr<clang::PPCallbacks> CreatePreprocessorCallbacks() {
-    return std::make_unique<GMockMemberRewriter::PPCallbacks>(this);
+  std::unique_ptr<clang::PPCallbacks> CreatePreprocessorCallbacks(
+      clang::Preprocessor& preprocessor) {
+    return std::make_unique<GMockMemberRewriter::PPCallbacks>(this,
+                                                              preprocessor);
   }
 
   clang::SourceLocation GetTargetLoc(
@@ -1321,17 +1555,25 @@ class GMockMemberRewriter
 
   class PPCallbacks : public clang::PPCallbacks {
    public:
-    explicit PPCallbacks(GMockMemberRewriter* rewriter) : rewriter_(rewriter) {}
+    PPCallbacks(GMockMemberRewriter* rewriter,
+                clang::Preprocessor& preprocessor)
+        : rewriter_(rewriter),
+          expect_call_(preprocessor.getIdentifierInfo("EXPECT_CALL")),
+          on_call_(preprocessor.getIdentifierInfo("ON_CALL")) {}
     ~PPCallbacks() override {}
+
+    // The names of the expanded macros are compared by their IdentifierInfo
+    // (looked up once per translation unit), rather than by their spelling.
+    // Note that the macros can't be recognized by their definitions seen by
+    // MacroDefined - it is not called for macros coming from a PCH or module.
+    // The callback runs for every expansion, even in translation units that
+    // don't use gmock, but there it stops after the two pointer comparisons.
     void MacroExpands(const clang::Token& name,
                       const clang::MacroDefinition& def,
                       clang::SourceRange range,
                       const clang::MacroArgs* args) override {
       clang::IdentifierInfo* id = name.getIdentifierInfo();
-      if (!id)
-        return;
-
-      if (id->getName() != "EXPECT_CALL" && id->getName() != "ON_CALL")
+      if (id != expect_call_ && id != on_call_)
         return;
 
       if (def.getMacroInfo()->getNumParams() != 2)
@@ -1347,6 +1589,8 @@ class GMockMemberRewriter
 
    private:
     GMockMemberRewriter* rewriter_;
+    const clang::IdentifierInfo* const expect_call_;
+    const clang::IdentifierInfo* const on_call_;
   };
 };
 
@@ -1400,8 +1644,11 @@ class UnresolvedRewriterBase : public RewriterBase<TargetNode> {
  public:
   using Base = RewriterBase<TargetNode>;
 
-  explicit UnresolvedRewriterBase(std::set<Replacement>* replacements)
-      : RewriterBase<TargetNode>(replacements, RenameCategory::kUnresolved) {}
+  UnresolvedRewriterBase(TranslationUnitRenames* renames,
+                         const NamingRules* naming_rules)
+      : RewriterBase<TargetNode>(renames,
+                                 naming_rules,
+                                 RenameCategory::kUnresolved) {}
 
   void run(const MatchFinder::MatchResult& result) override {
     const TargetNode& node = Base::GetTargetNode(result);
@@ -1447,13 +1694,46 @@ class UnresolvedRewriterBase : public RewriterBase<TargetNode> {
                                            clang::ASTContext& context,
                                            llvm::StringRef old_name,
                                            std::string& new_name) {
-    // |m_fieldName| -> |field_name_|.
+    const NamingRules& naming_rules = Base::naming_rules();
+
+    // |m_fieldName| -> |field_name_| (unless a field rule matches it).
     if (old_name.startswith(kBlinkFieldPrefix)) {
+      if (naming_rules.GetNewName(NamingRules::Kind::kField, old_name,
+                                  &new_name)) {
+        return true;
+      }
       std::string field_name = old_name.substr(strlen(kBlinkFieldPrefix));
       if (field_name.find('_') == std::string::npos) {
         new_name = CamelCaseToUnderscoreCase(field_name) + "_";
         return true;
       }
+    } else if (!naming_rules.empty()) {
+      // Other names matched by a naming rule of the kind they most likely
+      // resolve to.  Callees resolve to functions.  Other names may resolve to
+      // fields or to static members (e.g. |T::legacyFoo|), so they are only
+      // renamed if all the field, variable and constant rules matching them
+      // agree on the new name.
+      if (IsCallee(node, context)) {
+        if (naming_rules.GetNewName(NamingRules::Kind::kFunction, old_name,
+                                    &new_name)) {
+          return true;
+        }
+      } else {
+        bool has_matching_rule = false;
+        for (NamingRules::Kind kind :
+             {NamingRules::Kind::kField, NamingRules::Kind::kVariable,
+              NamingRules::Kind::kConstant}) {
+          std::string rule_new_name;
+          if (!naming_rules.GetNewName(kind, old_name, &rule_new_name))
+            continue;
+          if (has_matching_rule && rule_new_name != new_name)
+            return false;
+          has_matching_rule = true;
+          new_name = std::move(rule_new_name);
+        }
+        if (has_matching_rule)
+          return true;
+      }
     }
 
     // |T::myMethod(...)| -> |T::MyMethod(...)|.
@@ -1487,78 +1767,74 @@ using DependentScopeDeclRefExprRewriter =
 using CXXDependentScopeMemberExprRewriter =
     UnresolvedRewriterBase<clang::CXXDependentScopeMemberExpr>;
 
-class SourceFileCallbacks : public clang::tooling::SourceFileCallbacks {
+// Runs the rewriters over a single translation unit.  Each action has its own
+// MatchFinder, rewriters and caches, so that separate actions can process
+// different translation units in parallel.  The proposed renames are handed
+// over to the RenameTable once the translation unit is done.
+class RenameAction : public clang::ASTFrontendAction {
  public:
-  explicit SourceFileCallbacks(GMockMemberRewriter* gmock_member_rewriter)
-      : gmock_member_rewriter_(gmock_member_rewriter) {
-    assert(gmock_member_rewriter);
+  RenameAction(const MethodBlocklist& method_blocklist,
+               const NamingRules& naming_rules,
+               RenameTable* rename_table)
+      : naming_rules_(naming_rules),
+        rename_table_(rename_table),
+        blink_method_verdicts_(&renames_) {
+    AddMatchers(method_blocklist);
   }
 
-  ~SourceFileCallbacks() override {}
+  RenameAction(const RenameAction&) = delete;
+  RenameAction& operator=(const RenameAction&) = delete;
 
-  // clang::tooling::SourceFileCallbacks override:
-  bool handleBeginSource(clang::CompilerInstance& compiler) override {
-    compiler.getPreprocessor().addPPCallbacks(
-        gmock_member_rewriter_->CreatePreprocessorCallbacks());
+  // clang::ASTFrontendAction overrides:
+  std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+      clang::CompilerInstance& compiler,
+      llvm::StringRef in_file) override {
+    return match_finder_.newASTConsumer();
+  }
+  bool BeginSourceFileAction(clang::CompilerInstance& compiler) override {
+    GetCompileTimeEvaluationCache().clear();
+    clang::Preprocessor& preprocessor = compiler.getPreprocessor();
+    preprocessor.addPPCallbacks(
+        gmock_member_rewriter_->CreatePreprocessorCallbacks(preprocessor));
     return true;
   }
+  void EndSourceFileAction() override {
+    rename_table_->AddTranslationUnit(std::move(renames_));
+  }
 
  private:
-  GMockMemberRewriter* gmock_member_rewriter_;
-};
+  void AddMatchers(const MethodBlocklist& method_blocklist);
 
-}  // namespace
-
-static llvm::cl::extrahelp common_help(CommonOptionsParser::HelpMessage);
-
-int main(int argc, const char* argv[]) {
-  // TODO(dcheng): Clang tooling should do this itself.
-  // http://llvm.org/bugs/show_bug.cgi?id=21627
-  llvm::InitializeNativeTarget();
-  llvm::InitializeNativeTargetAsmParser();
-  llvm::cl::OptionCategory category(
-      "rewrite_to_chrome_style: convert Blink style to Chrome style.");
-  llvm::cl::opt<std::string> blocklisted_methods_file(
-      kMethodBlocklistParamName, llvm::cl::value_desc("filepath"),
-      llvm::cl::desc("file listing methods to be blocked (not renamed)"));
-  CommonOptionsParser options(argc, argv, category);
-  MethodBlocklist method_blocklist(blocklisted_methods_file);
-  clang::tooling::ClangTool tool(options.getCompilations(),
-                                 options.getSourcePathList());
+  template <typename Rewriter>
+  Rewriter& AddRewriter() {
+    auto rewriter = std::make_unique<Rewriter>(&renames_, &naming_rules_);
+    Rewriter& result = *rewriter;
+    rewriters_.push_back(std::move(rewriter));
+    return result;
+  }
 
-  MatchFinder match_finder;
-  std::set<Replacement> replacements;
+  const NamingRules& naming_rules_;
+  RenameTable* const rename_table_;
+  TranslationUnitRenames renames_;
+  BlinkDeclContextIndex blink_decl_context_index_;
+  OverriddenMethodsVerdicts blink_method_verdicts_;
+  std::vector<std::unique_ptr<MatchFinder::MatchCallback>> rewriters_;
+  GMockMemberRewriter* gmock_member_rewriter_ = nullptr;
+  MatchFinder match_finder_;
+};
 
+void RenameAction::AddMatchers(const MethodBlocklist& method_blocklist) {
   // Blink namespace matchers ========
-  auto blink_namespace_decl =
-      namespaceDecl(anyOf(hasName("blink"), hasName("WTF")),
-                    hasParent(translationUnitDecl()));
-  auto protocol_namespace_decl =
-      namespaceDecl(hasName("protocol"),
-                    hasParent(namespaceDecl(hasName("blink"),
-                                            hasParent(translationUnitDecl()))));
-
   // Given top-level compilation unit:
   //   namespace WTF {
   //     void foo() {}
   //   }
-  // matches |foo|.
-  auto decl_under_blink_namespace =
-      decl(hasAncestor(blink_namespace_decl),
-           unless(hasAncestor(protocol_namespace_decl)));
-
-  // Given top-level compilation unit:
   //   void WTF::function() {}
   //   void WTF::Class::method() {}
-  // matches |WTF::function| and |WTF::Class::method| decls.
-  auto decl_has_qualifier_to_blink_namespace =
-      declaratorDecl(has(nestedNameSpecifier(
-          hasTopLevelPrefix(specifiesNamespace(blink_namespace_decl)))));
-
-  auto in_blink_namespace = decl(
-      anyOf(decl_under_blink_namespace, decl_has_qualifier_to_blink_namespace,
-            hasAncestor(decl_has_qualifier_to_blink_namespace)),
-      unless(hasCanonicalDecl(isDeclInGeneratedFile())));
+  // matches |foo|, |WTF::function| and |WTF::Class::method| decls.
+  auto in_blink_namespace =
+      decl(isInBlinkNamespace(&blink_decl_context_index_),
+           unless(hasCanonicalDecl(isDeclInGeneratedFile())));
 
   // Field, variable, and enum declarations ========
   // Given
@@ -1582,15 +1858,16 @@ int main(int argc, const char* argv[]) {
   auto enum_member_decl_matcher =
       id("decl", enumConstantDecl(in_blink_namespace));
 
-  FieldDeclRewriter field_decl_rewriter(&replacements);
-  match_finder.addMatcher(field_decl_matcher, &field_decl_rewriter);
+  auto& field_decl_rewriter = AddRewriter<FieldDeclRewriter>();
+  match_finder_.addMatcher(field_decl_matcher, &field_decl_rewriter);
 
-  VarDeclRewriter var_decl_rewriter(&replacements);
-  match_finder.addMatcher(var_decl_matcher, &var_decl_rewriter);
-  match_finder.addMatcher(type_trait_decl_matcher, &var_decl_rewriter);
+  auto& var_decl_rewriter = AddRewriter<VarDeclRewriter>();
+  match_finder_.addMatcher(var_decl_matcher, &var_decl_rewriter);
+  match_finder_.addMatcher(type_trait_decl_matcher, &var_decl_rewriter);
 
-  EnumConstantDeclRewriter enum_member_decl_rewriter(&replacements);
-  match_finder.addMatcher(enum_member_decl_matcher, &enum_member_decl_rewriter);
+  auto& enum_member_decl_rewriter = AddRewriter<EnumConstantDeclRewriter>();
+  match_finder_.addMatcher(enum_member_decl_matcher,
+                           &enum_member_decl_rewriter);
 
   // Field, variable, and enum references ========
   // Given
@@ -1615,15 +1892,15 @@ int main(int argc, const char* argv[]) {
   auto enum_member_ref_matcher =
       id("expr", declRefExpr(to(enum_member_decl_matcher)));
 
-  MemberRewriter member_rewriter(&replacements);
-  match_finder.addMatcher(member_matcher, &member_rewriter);
+  auto& member_rewriter = AddRewriter<MemberRewriter>();
+  match_finder_.addMatcher(member_matcher, &member_rewriter);
 
-  DeclRefRewriter decl_ref_rewriter(&replacements);
-  match_finder.addMatcher(decl_ref_matcher, &decl_ref_rewriter);
-  match_finder.addMatcher(type_trait_ref_matcher, &decl_ref_rewriter);
+  auto& decl_ref_rewriter = AddRewriter<DeclRefRewriter>();
+  match_finder_.addMatcher(decl_ref_matcher, &decl_ref_rewriter);
+  match_finder_.addMatcher(type_trait_ref_matcher, &decl_ref_rewriter);
 
-  EnumConstantDeclRefRewriter enum_member_ref_rewriter(&replacements);
-  match_finder.addMatcher(enum_member_ref_matcher, &enum_member_ref_rewriter);
+  auto& enum_member_ref_rewriter = AddRewriter<EnumConstantDeclRefRewriter>();
+  match_finder_.addMatcher(enum_member_ref_matcher, &enum_member_ref_rewriter);
 
   // Member references in a non-member context ========
   // Given
@@ -1635,8 +1912,8 @@ int main(int argc, const char* argv[]) {
   // matches |&U::s_| but not |s_|.
   auto member_ref_matcher = id("expr", declRefExpr(to(field_decl_matcher)));
 
-  FieldDeclRefRewriter member_ref_rewriter(&replacements);
-  match_finder.addMatcher(member_ref_matcher, &member_ref_rewriter);
+  auto& member_ref_rewriter = AddRewriter<FieldDeclRefRewriter>();
+  match_finder_.addMatcher(member_ref_matcher, &member_ref_rewriter);
 
   // Non-method function declarations ========
   // Given
@@ -1658,10 +1935,10 @@ int main(int argc, const char* argv[]) {
               // prevent asserts about the identifier not being a simple name.
               isBlacklistedFunction(),
               // Functions that look like blocked static methods.
-              isBlocklistedMethod(method_blocklist))),
+              isBlocklistedMethod(&method_blocklist))),
           in_blink_namespace));
-  FunctionDeclRewriter function_decl_rewriter(&replacements);
-  match_finder.addMatcher(function_decl_matcher, &function_decl_rewriter);
+  auto& function_decl_rewriter = AddRewriter<FunctionDeclRewriter>();
+  match_finder_.addMatcher(function_decl_matcher, &function_decl_rewriter);
 
   // Non-method function references ========
   // Given
@@ -1672,8 +1949,8 @@ int main(int argc, const char* argv[]) {
       "expr", declRefExpr(to(function_decl_matcher),
                           // Ignore template substitutions.
                           unless(hasAncestor(substNonTypeTemplateParmExpr()))));
-  FunctionRefRewriter function_ref_rewriter(&replacements);
-  match_finder.addMatcher(function_ref_matcher, &function_ref_rewriter);
+  auto& function_ref_rewriter = AddRewriter<FunctionRefRewriter>();
+  match_finder_.addMatcher(function_ref_matcher, &function_ref_rewriter);
 
   // Method declarations ========
   // Given
@@ -1689,7 +1966,8 @@ int main(int argc, const char* argv[]) {
   auto is_blink_method = includeAllOverriddenMethods(
       allOf(in_blink_namespace,
             unless(anyOf(isBlacklistedMethod(),
-                         isBlocklistedMethod(method_blocklist)))));
+                         isBlocklistedMethod(&method_blocklist)))),
+      &blink_method_verdicts_);
   auto method_decl_matcher = id(
       "decl",
       cxxMethodDecl(
@@ -1704,8 +1982,8 @@ int main(int argc, const char* argv[]) {
           // asserts about overriding non-blink and blink for the
           // same method.
           is_blink_method));
-  MethodDeclRewriter method_decl_rewriter(&replacements);
-  match_finder.addMatcher(method_decl_matcher, &method_decl_rewriter);
+  auto& method_decl_rewriter = AddRewriter<MethodDeclRewriter>();
+  match_finder_.addMatcher(method_decl_matcher, &method_decl_rewriter);
 
   // Method references in a non-member context ========
   // Given
@@ -1718,8 +1996,8 @@ int main(int argc, const char* argv[]) {
                           // Ignore template substitutions.
                           unless(hasAncestor(substNonTypeTemplateParmExpr()))));
 
-  MethodRefRewriter method_ref_rewriter(&replacements);
-  match_finder.addMatcher(method_ref_matcher, &method_ref_rewriter);
+  auto& method_ref_rewriter = AddRewriter<MethodRefRewriter>();
+  match_finder_.addMatcher(method_ref_matcher, &method_ref_rewriter);
 
   // Method references in a member context ========
   // Given
@@ -1730,8 +2008,8 @@ int main(int argc, const char* argv[]) {
   auto method_member_matcher =
       id("expr", memberExpr(member(method_decl_matcher)));
 
-  MethodMemberRewriter method_member_rewriter(&replacements);
-  match_finder.addMatcher(method_member_matcher, &method_member_rewriter);
+  auto& method_member_rewriter = AddRewriter<MethodMemberRewriter>();
+  match_finder_.addMatcher(method_member_matcher, &method_member_rewriter);
 
   // Initializers ========
   // Given
@@ -1745,10 +2023,10 @@ int main(int argc, const char* argv[]) {
           "initializer",
           cxxCtorInitializer(forAnyField(field_decl_matcher), isWritten()))));
 
-  ConstructorInitializerRewriter constructor_initializer_rewriter(
-      &replacements);
-  match_finder.addMatcher(constructor_initializer_matcher,
-                          &constructor_initializer_rewriter);
+  auto& constructor_initializer_rewriter =
+      AddRewriter<ConstructorInitializerRewriter>();
+  match_finder_.addMatcher(constructor_initializer_matcher,
+                           &constructor_initializer_rewriter);
 
   // Unresolved lookup expressions ========
   // Given
@@ -1793,9 +2071,9 @@ int main(int argc, const char* argv[]) {
                 // t.method().
                 allOverloadsMatch(anyOf(method_decl_matcher,
                                         method_template_decl_matcher))))));
-  UnresolvedLookupRewriter unresolved_lookup_rewriter(&replacements);
-  match_finder.addMatcher(unresolved_lookup_matcher,
-                          &unresolved_lookup_rewriter);
+  auto& unresolved_lookup_rewriter = AddRewriter<UnresolvedLookupRewriter>();
+  match_finder_.addMatcher(unresolved_lookup_matcher,
+                           &unresolved_lookup_rewriter);
 
   // Unresolved member expressions (for non-dependent fields / methods) ========
   // Similar to unresolved lookup expressions, but for methods in a member
@@ -1807,9 +2085,9 @@ int main(int argc, const char* argv[]) {
           // Blink methods/method templates.
           allOverloadsMatch(
               anyOf(method_decl_matcher, method_template_decl_matcher)))));
-  UnresolvedMemberRewriter unresolved_member_rewriter(&replacements);
-  match_finder.addMatcher(unresolved_member_matcher,
-                          &unresolved_member_rewriter);
+  auto& unresolved_member_rewriter = AddRewriter<UnresolvedMemberRewriter>();
+  match_finder_.addMatcher(unresolved_member_matcher,
+                           &unresolved_member_rewriter);
 
   // Unresolved using value decls ========
   // Example:
@@ -1830,16 +2108,16 @@ int main(int argc, const char* argv[]) {
   auto unresolved_dependent_using_matcher =
       expr(id("expr", unresolvedMemberExpr(allOverloadsMatch(allOf(
                           in_blink_namespace, unresolvedUsingValueDecl())))));
-  UnresolvedDependentMemberRewriter unresolved_dependent_member_rewriter(
-      &replacements);
-  match_finder.addMatcher(unresolved_dependent_using_matcher,
-                          &unresolved_dependent_member_rewriter);
+  auto& unresolved_dependent_member_rewriter =
+      AddRewriter<UnresolvedDependentMemberRewriter>();
+  match_finder_.addMatcher(unresolved_dependent_using_matcher,
+                           &unresolved_dependent_member_rewriter);
   auto unresolved_using_value_decl_matcher =
       decl(id("decl", unresolvedUsingValueDecl(in_blink_namespace)));
-  UnresolvedUsingValueDeclRewriter unresolved_using_value_decl_rewriter(
-      &replacements);
-  match_finder.addMatcher(unresolved_using_value_decl_matcher,
-                          &unresolved_using_value_decl_rewriter);
+  auto& unresolved_using_value_decl_rewriter =
+      AddRewriter<UnresolvedUsingValueDeclRewriter>();
+  match_finder_.addMatcher(unresolved_using_value_decl_matcher,
+                           &unresolved_using_value_decl_rewriter);
 
   // Using declarations ========
   // Given
@@ -1850,8 +2128,8 @@ int main(int argc, const char* argv[]) {
                   var_decl_matcher, field_decl_matcher, function_decl_matcher,
                   method_decl_matcher, function_template_decl_matcher,
                   method_template_decl_matcher, enum_member_decl_matcher)))));
-  UsingDeclRewriter using_decl_rewriter(&replacements);
-  match_finder.addMatcher(using_decl_matcher, &using_decl_rewriter);
+  auto& using_decl_rewriter = AddRewriter<UsingDeclRewriter>();
+  match_finder_.addMatcher(using_decl_matcher, &using_decl_rewriter);
 
   // Matches any QualType that refers to a blink type:
   // - const blink::Foo&
@@ -1874,10 +2152,10 @@ int main(int argc, const char* argv[]) {
   auto dependent_scope_decl_ref_expr_matcher =
       expr(id("expr", dependentScopeDeclRefExpr(has(nestedNameSpecifier(
                           specifiesType(blink_qual_type_matcher))))));
-  DependentScopeDeclRefExprRewriter dependent_scope_decl_ref_expr_rewriter(
-      &replacements);
-  match_finder.addMatcher(dependent_scope_decl_ref_expr_matcher,
-                          &dependent_scope_decl_ref_expr_rewriter);
+  auto& dependent_scope_decl_ref_expr_rewriter =
+      AddRewriter<DependentScopeDeclRefExprRewriter>();
+  match_finder_.addMatcher(dependent_scope_decl_ref_expr_matcher,
+                           &dependent_scope_decl_ref_expr_rewriter);
 
   // Template-dependent member lookup ========
   // Given
@@ -1890,10 +2168,10 @@ int main(int argc, const char* argv[]) {
   auto cxx_dependent_scope_member_expr_matcher =
       expr(id("expr", cxxDependentScopeMemberExpr(
                           hasMemberFromType(blink_qual_type_matcher))));
-  CXXDependentScopeMemberExprRewriter cxx_dependent_scope_member_expr_rewriter(
-      &replacements);
-  match_finder.addMatcher(cxx_dependent_scope_member_expr_matcher,
-                          &cxx_dependent_scope_member_expr_rewriter);
+  auto& cxx_dependent_scope_member_expr_rewriter =
+      AddRewriter<CXXDependentScopeMemberExprRewriter>();
+  match_finder_.addMatcher(cxx_dependent_scope_member_expr_matcher,
+                           &cxx_dependent_scope_member_expr_rewriter);
 
   // GMock calls lookup ========
   // Given
@@ -1905,59 +2183,114 @@ int main(int argc, const char* argv[]) {
   auto gmock_member_matcher =
       id("expr", memberExpr(hasDeclaration(
                      decl(cxxMethodDecl(mocksMethod(method_decl_matcher))))));
-  GMockMemberRewriter gmock_member_rewriter(&replacements);
-  match_finder.addMatcher(gmock_member_matcher, &gmock_member_rewriter);
+  auto& gmock_member_rewriter = AddRewriter<GMockMemberRewriter>();
+  match_finder_.addMatcher(gmock_member_matcher, &gmock_member_rewriter);
+
+  gmock_member_rewriter_ = &gmock_member_rewriter;
+}
+
+class RenameActionFactory : public clang::tooling::FrontendActionFactory {
+ public:
+  RenameActionFactory(const MethodBlocklist& method_blocklist,
+                      const NamingRules& naming_rules,
+                      RenameTable* rename_table)
+      : method_blocklist_(method_blocklist),
+        naming_rules_(naming_rules),
+        rename_table_(rename_table) {}
+
+  RenameActionFactory(const RenameActionFactory&) = delete;
+  RenameActionFactory& operator=(const RenameActionFactory&) = delete;
+
+  // clang::tooling::FrontendActionFactory override:
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return std::make_unique<RenameAction>(method_blocklist_, naming_rules_,
+                                          rename_table_);
+  }
+
+ private:
+  const MethodBlocklist& method_blocklist_;
+  const NamingRules& naming_rules_;
+  RenameTable* const rename_table_;
+};
+
+}  // namespace
+
+static llvm::cl::extrahelp common_help(CommonOptionsParser::HelpMessage);
+
+int main(int argc, const char* argv[]) {
+  // TODO(dcheng): Clang tooling should do this itself.
+  // http://llvm.org/bugs/show_bug.cgi?id=21627
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmParser();
+  llvm::cl::OptionCategory category(
+      "rewrite_to_chrome_style: convert Blink style to Chrome style.");
+  llvm::cl::opt<std::string> blocklisted_methods_file(
+      kMethodBlocklistParamName, llvm::cl::value_desc("filepath"),
+      llvm::cl::desc("file listing methods to be blocked (not renamed)"));
+  llvm::cl::opt<std::string> naming_rules_file(
+      "naming-rules", llvm::cl::value_desc("filepath"),
+      llvm::cl::desc("file listing naming rules applied before the Blink to "
+                     "Chrome style conversion (see NamingRules.h)"));
+  llvm::cl::opt<std::string> tracked_edits_index_file(
+      "tracked-edits-index", llvm::cl::value_desc("filepath"),
+      llvm::cl::desc("file to write the edits tracked for the Blink rebase "
+                     "helper to, as a sorted index (instead of emitting a "
+                     "TRACKED EDITS section)"));
+  llvm::Expected<std::unique_ptr<clang::tooling::ToolExecutor>> executor =
+      clang::tooling::createExecutorFromCommandLineArgs(argc, argv, category);
+  if (!executor) {
+    llvm::errs() << llvm::toString(executor.takeError()) << "\n";
+    return 1;
+  }
+  MethodBlocklist method_blocklist(blocklisted_methods_file);
+  NamingRules naming_rules(naming_rules_file);
+  RenameTable rename_table;
 
   // Prepare and run the tool.
-  SourceFileCallbacks source_file_callbacks(&gmock_member_rewriter);
-  std::unique_ptr<clang::tooling::FrontendActionFactory> factory =
-      clang::tooling::newFrontendActionFactory(&match_finder,
-                                               &source_file_callbacks);
-  int result = tool.run(factory.get());
-  if (result != 0)
-    return result;
+  llvm::Error error = (*executor)->execute(
+      std::make_unique<RenameActionFactory>(method_blocklist, naming_rules,
+                                            &rename_table));
+  if (error) {
+    llvm::errs() << llvm::toString(std::move(error)) << "\n";
+    return 1;
+  }
+
+  // Drop the renames that are inconsistent across translation units.
+  std::set<Replacement> replacements;
+  EditTracker edit_tracker;
+  rename_table.Resolve(llvm::errs(), &replacements, &edit_tracker);
 
   // Supplemental data for the Blink rename rebase helper.
-  std::vector<const EditTracker*> all_edit_trackers{
-      field_decl_rewriter.edit_tracker(),
-      var_decl_rewriter.edit_tracker(),
-      enum_member_decl_rewriter.edit_tracker(),
-      member_rewriter.edit_tracker(),
-      decl_ref_rewriter.edit_tracker(),
-      enum_member_ref_rewriter.edit_tracker(),
-      member_ref_rewriter.edit_tracker(),
-      function_decl_rewriter.edit_tracker(),
-      function_ref_rewriter.edit_tracker(),
-      method_decl_rewriter.edit_tracker(),
-      method_ref_rewriter.edit_tracker(),
-      method_member_rewriter.edit_tracker(),
-      constructor_initializer_rewriter.edit_tracker(),
-      unresolved_lookup_rewriter.edit_tracker(),
-      unresolved_member_rewriter.edit_tracker(),
-      unresolved_dependent_member_rewriter.edit_tracker(),
-      unresolved_using_value_decl_rewriter.edit_tracker(),
-      using_decl_rewriter.edit_tracker(),
-      dependent_scope_decl_ref_expr_rewriter.edit_tracker(),
-      cxx_dependent_scope_member_expr_rewriter.edit_tracker(),
-      gmock_member_rewriter.edit_tracker(),
-  };
-  llvm::outs() << "==== BEGIN TRACKED EDITS ====\n";
-  for (const EditTracker* edit_tracker : all_edit_trackers)
-    edit_tracker->SerializeTo(llvm::outs());
-  llvm::outs() << "==== END TRACKED EDITS ====\n";
+  if (!tracked_edits_index_file.empty()) {
+    std::error_code ec;
+    llvm::raw_fd_ostream index_output(tracked_edits_index_file, ec);
+    if (ec) {
+      llvm::errs() << "ERROR: Cannot write the file specified in --"
+                   << tracked_edits_index_file.ArgStr << " argument: "
+                   << tracked_edits_index_file << ": " << ec.message() << "\n";
+      return 1;
+    }
+    edit_tracker.WriteIndexTo(index_output);
+  } else {
+    llvm::outs() << "==== BEGIN TRACKED EDITS ====\n";
+    edit_tracker.SerializeTo(llvm::outs());
+    llvm::outs() << "==== END TRACKED EDITS ====\n";
+  }
+
+  // Lets other tools look up the new names of the renamed declarations.
+  llvm::outs() << "==== BEGIN RENAME MAP ====\n";
+  rename_table.SerializeRenameMapTo(llvm::outs());
+  llvm::outs() << "==== END RENAME MAP ====\n";
 
   if (replacements.empty())
     return 0;
 
   // Serialization format is documented in tools/clang/scripts/run_tool.py
-  llvm::outs() << "==== BEGIN EDITS ====\n";
-  for (const auto& r : replacements) {
-    std::string replacement_text = r.getReplacementText().str();
-    std::replace(replacement_text.begin(), replacement_text.end(), '\n', '\0');
-    llvm::outs() << "r:::" << r.getFilePath() << ":::" << r.getOffset()
-                 << ":::" << r.getLength() << ":::" << replacement_text << "\n";
-  }
-  llvm::outs() << "==== END EDITS ====\n";
+  EditWriter edit_writer(&llvm::outs());
+  edit_writer.BeginEdits();
+  for (const auto& r : replacements)
+    edit_writer.WriteReplacement(r);
+  edit_writer.EndEdits();
 
   return 0;
 }
@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Looks up edits in an index written by rewrite_to_chrome_style.
+
+When run with --tracked-edits-index=<path>, rewrite_to_chrome_style writes the
+edits tracked for the Blink rebase helper to a sorted index (see EditTracker.h
+for the format) instead of emitting a TRACKED EDITS section.  The index is
+mmapped and binary searched, so only the pages needed by a lookup are read.
+
+Prints the matching edits in the format of the TRACKED EDITS section:
+    <filename>:<tag>:<original text>:<new text>
+
+Example usage:
+    $ query_tracked_edits.py ~/scratch/tracked-edits.index \\
+          third_party/blink/renderer/core/dom/node.h
+    $ query_tracked_edits.py ~/scratch/tracked-edits.index \\
+          third_party/blink/renderer/core/dom/node.h --original-text=m_parent
+"""
+
+import argparse
+import mmap
+import struct
+import sys
+
+INDEX_MAGIC = 0x42444554
+INDEX_VERSION = 1
+
+_UINT32 = struct.Struct('<I')
+_HEADER = struct.Struct('<4I')
+_EDIT = struct.Struct('<4I')
+
+
+class InputError(Exception):
+  pass
+
+
+class TrackedEditsIndex(object):
+  """Read-only view of an index written by EditTracker::WriteIndexTo."""
+
+  def __init__(self, data):
+    if len(data) < _HEADER.size:
+      raise InputError('Index is too short')
+    magic, version, self._string_count, self._edit_count = _HEADER.unpack_from(
+        data, 0)
+    if magic != INDEX_MAGIC or version != INDEX_VERSION:
+      raise InputError('Unexpected index magic or version')
+    self._data = data
+    self._offsets_start = _HEADER.size
+    self._edits_start = (self._offsets_start +
+                         (self._string_count + 1) * _UINT32.size)
+    self._strings_start = self._edits_start + self._edit_count * _EDIT.size
+
+  def GetString(self, index):
+    offset = self._offsets_start + index * _UINT32.size
+    start = _UINT32.unpack_from(self._data, offset)[0]
+    end = _UINT32.unpack_from(self._data, offset + _UINT32.size)[0]
+    return self._data[self._strings_start + start:self._strings_start + end]
+
+  def FindString(self, string):
+    """Returns the index of |string| (bytes), or None if it isn't indexed."""
+    low, high = 0, self._string_count
+    while low < high:
+      middle = (low + high) // 2
+      if self.GetString(middle) < string:
+        low = middle + 1
+      else:
+        high = middle
+    if low < self._string_count and self.GetString(low) == string:
+      return low
+    return None
+
+  def GetEdit(self, index):
+    return _EDIT.unpack_from(self._data, self._edits_start + index * _EDIT.size)
+
+  def FindEdits(self, filename, original_text=None):
+    """Yields (filename, tag, original text, new text) tuples of bytes."""
+    filename_index = self.FindString(filename)
+    if filename_index is None:
+      return
+    key = (filename_index, )
+    if original_text is not None:
+      original_text_index = self.FindString(original_text)
+      if original_text_index is None:
+        return
+      key += (original_text_index, )
+
+    # Edits are sorted by (filename, original text, tag, new text).
+    low, high = 0, self._edit_count
+    while low < high:
+      middle = (low + high) // 2
+      edit = self.GetEdit(middle)
+      if (edit[0], edit[2])[:len(key)] < key:
+        low = middle + 1
+      else:
+        high = middle
+
+    for index in range(low, self._edit_count):
+      edit = self.GetEdit(index)
+      if (edit[0], edit[2])[:len(key)] != key:
+        break
+      yield tuple(self.GetString(i) for i in edit)
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('index', help='index written by rewrite_to_chrome_style')
+  parser.add_argument('filename', help='filename to look up the edits of')
+  parser.add_argument('--original-text',
+                      help='only print the edits of this original text')
+  args = parser.parse_args()
+
+  original_text = None
+  if args.original_text is not None:
+    original_text = args.original_text.encode('utf-8')
+
+  with open(args.index, 'rb') as f:
+    data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    try:
+      index = TrackedEditsIndex(data)
+      for edit in index.FindEdits(args.filename.encode('utf-8'),
+                                  original_text):
+        sys.stdout.write(b':'.join(edit).decode('utf-8') + '\n')
+    except InputError as e:
+      sys.stderr.write('ERROR: %s\n' % e)
+      return 1
+    finally:
+      data.close()
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
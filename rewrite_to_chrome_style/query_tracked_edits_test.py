@@ -0,0 +1,153 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+import os
+import shutil
+import struct
+import subprocess
+import tempfile
+import unittest
+
+import query_tracked_edits
+
+_TOOL_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          '../../../third_party/llvm-build/Release+Asserts/bin',
+                          'rewrite_to_chrome_style')
+
+
+def _WriteIndex(edits):
+  """Returns the index of |edits| in the format of EditTracker::WriteIndexTo.
+
+  |edits| is a list of (filename, tag, original text, new text) tuples of
+  bytes.
+  """
+  strings = sorted(set(s for edit in edits for s in edit))
+  string_indices = dict((s, i) for i, s in enumerate(strings))
+  indexed_edits = sorted(
+      set(tuple(string_indices[s] for s in edit) for edit in edits),
+      key=lambda edit: (edit[0], edit[2], edit[1], edit[3]))
+
+  data = struct.pack('<4I', query_tracked_edits.INDEX_MAGIC,
+                     query_tracked_edits.INDEX_VERSION, len(strings),
+                     len(indexed_edits))
+  offset = 0
+  data += struct.pack('<I', offset)
+  for s in strings:
+    offset += len(s)
+    data += struct.pack('<I', offset)
+  for edit in indexed_edits:
+    data += struct.pack('<4I', *edit)
+  return data + b''.join(strings)
+
+
+_EDITS = [
+    (b'a.h', b'var', b'm_count', b'count_'),
+    (b'a.h', b'func', b'doSomething', b'DoSomething'),
+    (b'a.h', b'func', b'm_count', b'Count'),
+    (b'b.h', b'var', b'm_count', b'count_'),
+    (b'b.h', b'enum', b'kValue', b'kValue2'),
+]
+
+
+class TrackedEditsIndexTest(unittest.TestCase):
+  def setUp(self):
+    self.index = query_tracked_edits.TrackedEditsIndex(_WriteIndex(_EDITS))
+
+  def testFindString(self):
+    self.assertEqual(b'a.h',
+                     self.index.GetString(self.index.FindString(b'a.h')))
+    self.assertIsNone(self.index.FindString(b'c.h'))
+    self.assertIsNone(self.index.FindString(b''))
+
+  def testFindEditsOfFilename(self):
+    self.assertEqual([
+        (b'a.h', b'func', b'doSomething', b'DoSomething'),
+        (b'a.h', b'func', b'm_count', b'Count'),
+        (b'a.h', b'var', b'm_count', b'count_'),
+    ], list(self.index.FindEdits(b'a.h')))
+    self.assertEqual([
+        (b'b.h', b'enum', b'kValue', b'kValue2'),
+        (b'b.h', b'var', b'm_count', b'count_'),
+    ], list(self.index.FindEdits(b'b.h')))
+
+  def testFindEditsOfOriginalText(self):
+    self.assertEqual([
+        (b'a.h', b'func', b'm_count', b'Count'),
+        (b'a.h', b'var', b'm_count', b'count_'),
+    ], list(self.index.FindEdits(b'a.h', b'm_count')))
+    self.assertEqual([], list(self.index.FindEdits(b'a.h', b'kValue')))
+
+  def testFindEditsOfUnknownStrings(self):
+    self.assertEqual([], list(self.index.FindEdits(b'c.h')))
+    # Filenames are strings of the index too, but have no edits of their own.
+    self.assertEqual([], list(self.index.FindEdits(b'm_count')))
+    self.assertEqual([], list(self.index.FindEdits(b'a.h', b'unknown')))
+
+  def testEmptyIndex(self):
+    index = query_tracked_edits.TrackedEditsIndex(_WriteIndex([]))
+    self.assertEqual([], list(index.FindEdits(b'a.h')))
+
+  def testInvalidIndex(self):
+    with self.assertRaises(query_tracked_edits.InputError):
+      query_tracked_edits.TrackedEditsIndex(b'TEDB')
+    data = bytearray(_WriteIndex(_EDITS))
+    data[0] ^= 1
+    with self.assertRaises(query_tracked_edits.InputError):
+      query_tracked_edits.TrackedEditsIndex(bytes(data))
+
+
+class RoundTripTest(unittest.TestCase):
+  """Checks that the index written by the tool has the same edits as the
+  TRACKED EDITS section."""
+
+  def setUp(self):
+    if not os.path.exists(_TOOL_PATH):
+      self.skipTest('rewrite_to_chrome_style is not built')
+    self.temp_dir = tempfile.mkdtemp()
+
+  def tearDown(self):
+    shutil.rmtree(self.temp_dir)
+
+  def _RunTool(self, source_path, extra_args):
+    return subprocess.check_output([_TOOL_PATH] + extra_args +
+                                   [source_path, '--', '-std=c++14'])
+
+  def testRoundTrip(self):
+    source_path = os.path.join(self.temp_dir, 'test.cc')
+    with open(source_path, 'w') as f:
+      f.write('namespace blink {\n'
+              'enum Color { ColorRed };\n'
+              'class Foo {\n'
+              ' public:\n'
+              '  int doSomething() { return m_count + s_instanceCount; }\n'
+              '  int m_count;\n'
+              '  static int s_instanceCount;\n'
+              '};\n'
+              '}  // namespace blink\n')
+
+    output = self._RunTool(source_path, [])
+    lines = output.decode('utf-8').splitlines()
+    begin = lines.index('==== BEGIN TRACKED EDITS ====')
+    end = lines.index('==== END TRACKED EDITS ====')
+    tracked_edits = sorted(
+        tuple(line.encode('utf-8').split(b':', 3))
+        for line in lines[begin + 1:end])
+    self.assertTrue(tracked_edits)
+
+    index_path = os.path.join(self.temp_dir, 'tracked-edits.index')
+    output = self._RunTool(source_path, ['--tracked-edits-index=' + index_path])
+    self.assertNotIn(b'TRACKED EDITS', output)
+    with open(index_path, 'rb') as f:
+      index = query_tracked_edits.TrackedEditsIndex(f.read())
+    filenames = sorted(set(edit[0] for edit in tracked_edits))
+    indexed_edits = sorted(edit for filename in filenames
+                           for edit in index.FindEdits(filename))
+    self.assertEqual(tracked_edits, indexed_edits)
+    for edit in tracked_edits:
+      self.assertIn(edit, list(index.FindEdits(edit[0], edit[2])))
+
+
+if __name__ == '__main__':
+  unittest.main()
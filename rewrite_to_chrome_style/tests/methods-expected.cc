@@ -315,6 +315,9 @@ class IdlTestClass {
   int idlTemplateMethod(T x) {
     return 123;
   }
+
+  int IdlOverloadedMethod() { return 123; }
+  int idlOverloadedMethod(int x) { return 123; }
 };
 
 template <typename T>
@@ -323,6 +326,12 @@ class IdlTemplateClass {
   int idlInstanceMethod(T x) { return 123; }
 };
 
+class IdlQualifiedClass {
+ public:
+  int idlMethod() { return 123; }
+  int IdlOtherMethod() { return 123; }
+};
+
 }  // namespace blink
 
 // https://crbug.com/640688 - need to rewrite method name below.
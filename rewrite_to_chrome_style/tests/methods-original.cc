@@ -319,6 +319,9 @@ class IdlTestClass {
   int idlTemplateMethod(T x) {
     return 123;
   }
+
+  int idlOverloadedMethod() { return 123; }
+  int idlOverloadedMethod(int x) { return 123; }
 };
 
 template <typename T>
@@ -327,6 +330,12 @@ class IdlTemplateClass {
   int idlInstanceMethod(T x) { return 123; }
 };
 
+class IdlQualifiedClass {
+ public:
+  int idlMethod() { return 123; }
+  int idlOtherMethod() { return 123; }
+};
+
 }  // namespace blink
 
 // https://crbug.com/640688 - need to rewrite method name below.
@@ -0,0 +1,62 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests for --naming-rules cmdline parameter (see naming_rules.txt).
+
+namespace blink {
+
+const int kMaxNumberOfItems = 5;
+// Constants not matched by any rule get the default conversion.
+const int kLegacyMinItems = 1;
+
+enum LegacyEnum {
+  kNewFirst,
+  kNewSecond,
+  // Enum values not matched by any rule get the default conversion.
+  kOtherValue,
+};
+
+class LegacyApi {
+ public:
+  // Renamed by the func rule.
+  void DoThing() {}
+  int Count() const { return counter_ + other_counter_; }
+  // Methods not matched by any rule get the default conversion.
+  void DoOtherThing() {}
+
+ private:
+  // Renamed by the field rule.
+  int counter_;
+  // Fields not matched by any rule get the default conversion.
+  int other_counter_;
+};
+
+struct LegacyStatics {
+  // Renamed by the var rule.
+  static int foo_in_use;
+};
+
+void F() {
+  // Renamed by the var rule.
+  int buffers_in_use = kMaxNumberOfItems - kLegacyMinItems;
+  LegacyApi api;
+  api.DoThing();
+  api.DoOtherThing();
+  buffers_in_use += api.Count() + kNewFirst + kOtherValue;
+}
+
+template <typename T>
+void G(T& t) {
+  // Names depending on template parameters are also renamed by the rules.
+  t.DoThing();
+}
+
+template <typename T>
+int H(T& t) {
+  // Dependent fields and static members are renamed by the field, var and const
+  // rules.
+  return t.counter_ + T::foo_in_use;
+}
+
+}  // namespace blink
@@ -0,0 +1,62 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests for --naming-rules cmdline parameter (see naming_rules.txt).
+
+namespace blink {
+
+const int legacyMaxItems = 5;
+// Constants not matched by any rule get the default conversion.
+const int legacyMinItems = 1;
+
+enum LegacyEnum {
+  legacyValueFirst,
+  legacyValueSecond,
+  // Enum values not matched by any rule get the default conversion.
+  otherValue,
+};
+
+class LegacyApi {
+ public:
+  // Renamed by the func rule.
+  void legacyDoThing() {}
+  int legacyCount() const { return m_legacyCounter + m_otherCounter; }
+  // Methods not matched by any rule get the default conversion.
+  void doOtherThing() {}
+
+ private:
+  // Renamed by the field rule.
+  int m_legacyCounter;
+  // Fields not matched by any rule get the default conversion.
+  int m_otherCounter;
+};
+
+struct LegacyStatics {
+  // Renamed by the var rule.
+  static int legacyFoo;
+};
+
+void F() {
+  // Renamed by the var rule.
+  int legacyBuffers = legacyMaxItems - legacyMinItems;
+  LegacyApi api;
+  api.legacyDoThing();
+  api.doOtherThing();
+  legacyBuffers += api.legacyCount() + legacyValueFirst + otherValue;
+}
+
+template <typename T>
+void G(T& t) {
+  // Names depending on template parameters are also renamed by the rules.
+  t.legacyDoThing();
+}
+
+template <typename T>
+int H(T& t) {
+  // Dependent fields and static members are renamed by the field, var and const
+  // rules.
+  return t.m_legacyCounter + T::legacyFoo;
+}
+
+}  // namespace blink
@@ -0,0 +1,42 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+namespace blink {
+
+// IdlOverriddenClass::doTheWork is listed in blocked_methods.txt, so it is not
+// renamed.
+class IdlOverriddenClass {
+ public:
+  virtual void doTheWork() {}
+};
+
+class RenamedBase {
+ public:
+  virtual void doTheWork() {}
+  // Methods without conflicts are still renamed.
+  virtual void DoOtherWork() {}
+};
+
+// Overrides a method that is renamed and one that isn't.  Renaming only some of
+// them would disconnect the overrides, so none of them is renamed.
+class OverridesBoth : public IdlOverriddenClass, public RenamedBase {
+ public:
+  void doTheWork() override {}
+};
+
+// Only overrides RenamedBase::doTheWork, but still can't be renamed without
+// the rest of the methods that override or are overridden by it.
+class OverridesRenamedBase : public RenamedBase {
+ public:
+  void doTheWork() override {}
+  void DoOtherWork() override {}
+};
+
+void F(RenamedBase* base, OverridesRenamedBase* derived) {
+  base->doTheWork();
+  derived->doTheWork();
+  base->DoOtherWork();
+}
+
+}  // namespace blink
@@ -32,7 +32,13 @@ extract_edits.py would emit the following output:
     <yet another edit1>
     <yet another edit2>
 
-This python script is mainly needed on Windows.
+Tools that use tools/clang/common/EditWriter.h can also be run with
+--edits-format=binary, in which case they emit edits as compact binary records
+delimited by "==== BEGIN BINARY EDITS ====" and "==== END BINARY EDITS ===="
+lines (see EditWriter.h for the format).  extract_edits.py converts such edits
+back to the text format above.
+
+This python script is mainly needed on Windows (or for binary edits).
 On unix this script can be replaced with running sed as follows:
 
     $ cat run_tool.debug.out \
@@ -42,26 +48,109 @@ On unix this script can be replaced with running sed as follows:
 
 from __future__ import print_function
 
+import os
 import sys
 
 
+_BEGIN_EDITS = b'==== BEGIN EDITS ===='
+_END_EDITS = b'==== END EDITS ===='
+_BEGIN_BINARY_EDITS = b'==== BEGIN BINARY EDITS ===='
+_END_BINARY_EDITS = b'==== END BINARY EDITS ===='
+
+
+def _SetBinaryMode(stream):
+  """Stops Windows from translating newlines (and ^Z) in |stream|."""
+  if sys.platform == 'win32':
+    import msvcrt
+    msvcrt.setmode(stream.fileno(), os.O_BINARY)
+
+
+def _ReadBytes(stream, size):
+  data = stream.read(size)
+  if len(data) != size:
+    raise ValueError('Malformed binary edits')
+  return data
+
+
+def _ReadULEB128(stream):
+  result = 0
+  shift = 0
+  while True:
+    byte = ord(_ReadBytes(stream, 1))
+    result |= (byte & 0x7f) << shift
+    shift += 7
+    if not byte & 0x80:
+      return result
+
+
+def _ReadString(stream, string_table):
+  index = _ReadULEB128(stream)
+  if index >= len(string_table):
+    raise ValueError('Malformed binary edits')
+  return string_table[index]
+
+
+def _ReadBinaryEdits(stream):
+  """Yields the text form of the binary edits up to the END BINARY marker.
+
+  Raises ValueError if the edits are malformed or truncated.
+  """
+  string_table = []
+  while True:
+    record_type = stream.read(1)
+    if record_type == b's':
+      string_table.append(_ReadBytes(stream, _ReadULEB128(stream)))
+    elif record_type == b'e':
+      edit_type = _ReadString(stream, string_table)
+      path = _ReadString(stream, string_table)
+      offset = _ReadULEB128(stream) - 1
+      length = _ReadULEB128(stream) - 1
+      text = _ReadBytes(stream, _ReadULEB128(stream)).replace(b'\n', b'\0')
+      yield b':::'.join(
+          [edit_type, path,
+           str(offset).encode(),
+           str(length).encode(), text])
+    else:
+      # The record type byte is the first byte of the END BINARY marker.
+      end_marker = (record_type + stream.readline()).rstrip(b'\n\r')
+      if end_marker != _END_BINARY_EDITS:
+        raise ValueError('Malformed binary edits')
+      return
+
+
 def main():
+  # Binary edits are not valid text, so stdin (and stdout) need to be treated
+  # as bytes.
+  _SetBinaryMode(sys.stdin)
+  _SetBinaryMode(sys.stdout)
+  stdin = getattr(sys.stdin, 'buffer', sys.stdin)
+  stdout = getattr(sys.stdout, 'buffer', sys.stdout)
+
   # TODO(dcheng): extract_edits.py should normalize paths. Doing this in
   # apply_edits.py is too late, as a common use case is to apply edits from many
   # different platforms.
   unique_lines = set()
+
+  def _Emit(line):
+    if line not in unique_lines:
+      unique_lines.add(line)
+      stdout.write(line + b'\n')
+
   inside_marker_lines = False
-  for line in sys.stdin:
-    line = line.rstrip("\n\r")
-    if line == '==== BEGIN EDITS ====':
+  for line in iter(stdin.readline, b''):
+    line = line.rstrip(b'\n\r')
+    if line == _BEGIN_EDITS:
       inside_marker_lines = True
       continue
-    if line == '==== END EDITS ====':
+    if line == _END_EDITS:
       inside_marker_lines = False
       continue
-    if inside_marker_lines and line not in unique_lines:
-      unique_lines.add(line)
-      print(line)
+    if line == _BEGIN_BINARY_EDITS:
+      for edit in _ReadBinaryEdits(stdin):
+        _Emit(edit)
+      continue
+    if inside_marker_lines:
+      _Emit(line)
   return 0
 
 
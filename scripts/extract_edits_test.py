@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+# Copyright 2021 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+import io
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import extract_edits
+
+_SCRIPT_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            'extract_edits.py')
+_TOOL_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          '../../../third_party/llvm-build/Release+Asserts/bin',
+                          'rewrite_to_chrome_style')
+
+
+def _ExtractEdits(tool_output):
+  process = subprocess.Popen([sys.executable, _SCRIPT_PATH],
+                             stdin=subprocess.PIPE,
+                             stdout=subprocess.PIPE)
+  stdout, _ = process.communicate(tool_output)
+  if process.returncode != 0:
+    raise subprocess.CalledProcessError(process.returncode, _SCRIPT_PATH)
+  return stdout
+
+
+# The binary form of:
+#   r:::a.h:::4:::7:::count_
+#   include-user-header:::a.h:::-1:::-1:::b.h
+_BINARY_EDITS = (b'==== BEGIN BINARY EDITS ====\n'
+                 b's\x01r'
+                 b's\x03a.h'
+                 b'e\x00\x01\x05\x08\x06count_'
+                 b's\x13include-user-header'
+                 b'e\x02\x01\x00\x00\x03b.h'
+                 b'==== END BINARY EDITS ====\n')
+
+
+class ReadBinaryEditsTest(unittest.TestCase):
+  def _Read(self, data):
+    stream = io.BytesIO(data)
+    self.assertEqual(b'==== BEGIN BINARY EDITS ====\n', stream.readline())
+    return list(extract_edits._ReadBinaryEdits(stream))
+
+  def testEdits(self):
+    self.assertEqual([
+        b'r:::a.h:::4:::7:::count_',
+        b'include-user-header:::a.h:::-1:::-1:::b.h',
+    ], self._Read(_BINARY_EDITS))
+
+  def testNewlinesInText(self):
+    self.assertEqual([b'r:::a.h:::0:::0:::a\0b'],
+                     self._Read(b'==== BEGIN BINARY EDITS ====\n'
+                                b's\x01rs\x03a.he\x00\x01\x01\x01\x03a\nb'
+                                b'==== END BINARY EDITS ====\n'))
+
+  def testTruncated(self):
+    end = _BINARY_EDITS.index(b'==== END')
+    for size in range(len(b'==== BEGIN BINARY EDITS ====\n') + 1, end):
+      with self.assertRaises(ValueError):
+        self._Read(_BINARY_EDITS[:size])
+
+  def testInvalidStringIndex(self):
+    with self.assertRaises(ValueError):
+      self._Read(b'==== BEGIN BINARY EDITS ====\n'
+                 b's\x01re\x00\x01\x01\x01\x00'
+                 b'==== END BINARY EDITS ====\n')
+
+
+class RoundTripTest(unittest.TestCase):
+  """Checks that the binary edits written by EditWriter are extracted as the
+  same lines as the text edits."""
+
+  def setUp(self):
+    if not os.path.exists(_TOOL_PATH):
+      self.skipTest('rewrite_to_chrome_style is not built')
+    self.temp_dir = tempfile.mkdtemp()
+
+  def tearDown(self):
+    shutil.rmtree(self.temp_dir)
+
+  def _RunTool(self, source_path, edits_format):
+    return subprocess.check_output([
+        _TOOL_PATH, '--edits-format=' + edits_format, source_path, '--',
+        '-std=c++14'
+    ])
+
+  def testRoundTrip(self):
+    source_path = os.path.join(self.temp_dir, 'test.cc')
+    with open(source_path, 'w') as f:
+      f.write('namespace blink {\n'
+              'class Foo {\n'
+              ' public:\n'
+              '  int doSomething() { return m_count; }\n'
+              '  int m_count;\n'
+              '};\n'
+              '}  // namespace blink\n')
+
+    text_edits = _ExtractEdits(self._RunTool(source_path, 'text'))
+    self.assertTrue(text_edits)
+    binary_output = self._RunTool(source_path, 'binary')
+    self.assertIn(b'==== BEGIN BINARY EDITS ====', binary_output)
+    self.assertEqual(text_edits, _ExtractEdits(binary_output))
+
+
+if __name__ == '__main__':
+  unittest.main()
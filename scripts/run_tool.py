@@ -43,7 +43,16 @@ following format:
     ==== END EDITS ====
     ...
 
-extract_edits.py extracts only lines between BEGIN/END EDITS markers
+Tools that use common/EditWriter.h can be passed
+--tool-arg=--edits-format=binary to emit edits in a more compact binary format
+instead (between BEGIN/END BINARY EDITS markers).  Passing
+--skip-duplicate-edits makes the tool invocations share an index of emitted
+edits (created afresh for every run), so that edits of commonly included
+headers are only emitted once (note that edits emitted by failing invocations
+are then lost).
+
+extract_edits.py extracts only lines between BEGIN/END EDITS markers (and
+converts binary edits back to lines)
 apply_edits.py reads edit lines from stdin and applies the edits
 """
 
@@ -57,9 +66,11 @@ import multiprocessing
 import os
 import os.path
 import re
+import shutil
 import subprocess
 import shlex
 import sys
+import tempfile
 
 script_dir = os.path.dirname(os.path.realpath(__file__))
 tool_dir = os.path.abspath(os.path.join(script_dir, '../pylib'))
@@ -302,7 +313,8 @@ class _CompilerDispatcher(object):
     """
     if result['status']:
       self.__success_count += 1
-      sys.stdout.write(result['stdout_text'])
+      # The output may contain binary edits, so it's written as bytes.
+      getattr(sys.stdout, 'buffer', sys.stdout).write(result['stdout_text'])
       sys.stderr.write(result['stderr_text'])
     else:
       self.__failed_count += 1
@@ -356,6 +368,11 @@ def main():
   parser.add_argument(
       '--tool-path', nargs='?',
       help='optional path to the tool directory')
+  parser.add_argument(
+      '--skip-duplicate-edits',
+      action='store_true',
+      help='only emit each edit once, even if several tool invocations '
+      'produce it (requires a tool that uses common/EditWriter.h)')
   args = parser.parse_args(argv)
 
   if args.tool_path:
@@ -403,11 +420,29 @@ def main():
     print('Shard %d-of-%d will process %d entries out of %d' %
           (shard_number, shard_count, len(compdb_entries), total_length))
 
-  dispatcher = _CompilerDispatcher(os.path.join(tool_path, args.tool),
-                                   args.tool_arg,
-                                   args.p,
-                                   compdb_entries)
-  dispatcher.Run()
+  if sys.platform == 'win32':
+    # Text mode would translate the newlines in binary edits.
+    import msvcrt
+    msvcrt.setmode(sys.stdout.fileno(), os.O_BINARY)
+
+  tool_args = list(args.tool_arg or [])
+  temp_dir = None
+  if args.skip_duplicate_edits:
+    # The index must not outlive the run: a later run over the same files would
+    # find all of its edits in the index and emit nothing.
+    temp_dir = tempfile.mkdtemp()
+    tool_args.append('--emitted-edits-index=' +
+                     os.path.join(temp_dir, 'emitted-edits.index'))
+
+  try:
+    dispatcher = _CompilerDispatcher(os.path.join(tool_path, args.tool),
+                                     tool_args,
+                                     args.p,
+                                     compdb_entries)
+    dispatcher.Run()
+  finally:
+    if temp_dir:
+      shutil.rmtree(temp_dir)
   return -dispatcher.failed_count
 
 
@@ -137,7 +137,13 @@ def _NormalizePathInRawOutput(path, test_dir):
 
 def _NormalizeSingleRawOutputLine(output_line, test_dir):
   if not re.match('^[^:]+(:::.*){4,4}$', output_line):
-    return output_line
+    # Edits keyed by a qualified field name (e.g. FIELD EDITS emitted by
+    # rewrite_raw_ptr_fields --single-pass) are prefixed with '<field>:::'.
+    match = re.match('^([^:]+::[^ ]*?:::)(.*)$', output_line, re.DOTALL)
+    if not match or not re.match('^[^:]+(:::.*){4,4}$', match.group(2)):
+      return output_line
+    return match.group(1) + _NormalizeSingleRawOutputLine(match.group(2),
+                                                          test_dir)
 
   edit_type, path, offset, length, replacement = output_line.split(':::', 4)
   path = _NormalizePathInRawOutput(path, test_dir)
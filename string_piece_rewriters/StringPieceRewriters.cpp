@@ -29,6 +29,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetSelect.h"
 
+#include "common/EditWriter.h"
+
 using clang::tooling::AtomicChange;
 using clang::tooling::AtomicChanges;
 using clang::tooling::Transformer;
@@ -255,21 +257,16 @@ int main(int argc, const char* argv[]) {
     return 0;
 
   // Serialization format is documented in tools/clang/scripts/run_tool.py
-  llvm::outs() << "==== BEGIN EDITS ====\n";
+  EditWriter edit_writer(&llvm::outs());
+  edit_writer.BeginEdits();
   for (const auto& change : changes) {
-    for (const auto& r : change.getReplacements()) {
-      std::string replacement(r.getReplacementText());
-      std::replace(replacement.begin(), replacement.end(), '\n', '\0');
-      llvm::outs() << "r:::" << r.getFilePath() << ":::" << r.getOffset()
-                   << ":::" << r.getLength() << ":::" << replacement << "\n";
-    }
+    for (const auto& r : change.getReplacements())
+      edit_writer.WriteReplacement(r);
 
-    for (const auto& header : change.getInsertedHeaders()) {
-      llvm::outs() << "include-user-header:::" << change.getFilePath()
-                   << ":::-1:::-1:::" << header << "\n";
-    }
+    for (const auto& header : change.getInsertedHeaders())
+      edit_writer.WriteIncludeUserHeader(change.getFilePath(), header);
   }
-  llvm::outs() << "==== END EDITS ====\n";
+  edit_writer.EndEdits();
 
   return 0;
 }
@@ -18,6 +18,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormatVariadic.h"
 
+#include "common/EditWriter.h"
+
 using namespace clang::ast_matchers;
 using clang::tooling::CommonOptionsParser;
 using clang::tooling::Replacement;
@@ -191,23 +193,21 @@ int main(int argc, const char* argv[]) {
   // Keep a set of files where we have already added base_tracing include.
   std::set<std::string> include_added_to;
 
-  llvm::outs() << "==== BEGIN EDITS ====\n";
+  EditWriter edit_writer(&llvm::outs());
+  edit_writer.BeginEdits();
   for (const auto& r : replacements) {
     // Add base_tracing import if necessary.
     if (include_added_to.find(r.getFilePath().str()) ==
         include_added_to.end()) {
       include_added_to.insert(r.getFilePath().str());
       // Add also copyright so that |test-expected.cc| passes presubmit.
-      llvm::outs() << "include-user-header:::" << r.getFilePath()
-                   << ":::-1:::-1:::base/trace_event/base_tracing.h"
-                   << "\n";
+      edit_writer.WriteIncludeUserHeader(r.getFilePath(),
+                                         "base/trace_event/base_tracing.h");
     }
     // Add the actual replacement.
-    llvm::outs() << "r:::" << r.getFilePath() << ":::" << r.getOffset()
-                 << ":::" << r.getLength() << ":::" << r.getReplacementText()
-                 << "\n";
+    edit_writer.WriteReplacement(r);
   }
-  llvm::outs() << "==== END EDITS ====\n";
+  edit_writer.EndEdits();
 
   return 0;
 }